@@ -22,15 +22,33 @@ SOFTWARE.
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <functional>
+#include <future>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define VKW_COROUTINES 1
+#endif
+
 #if _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
 #elif __linux__
@@ -44,6 +62,8 @@ namespace vkw
 namespace Impl
 {
 
+struct ObjectCaches;
+
 template <typename T>
 class Object
 {
@@ -74,9 +94,16 @@ public:
         Object<T>::obj_ = std::unique_ptr<void, std::function<void(void*)>>(VK_NULL_HANDLE, [](void*) {});
     }
 
-    explicit DispatchableObject(T& t)
+    explicit DispatchableObject(T& t, bool destroyable = true)
     {
-        Object<T>::obj_ = std::unique_ptr<void, std::function<void(void*)>>(t, [](void* t) { D(static_cast<T>(t), nullptr); });
+        if (destroyable)
+        {
+            Object<T>::obj_ = std::unique_ptr<void, std::function<void(void*)>>(t, [](void* t) { D(static_cast<T>(t), nullptr); });
+        }
+        else
+        {
+            Object<T>::obj_ = std::unique_ptr<void, std::function<void(void*)>>(t, [](void*) {});
+        }
     }
 };
 
@@ -114,6 +141,16 @@ protected:
     M m_;
 };
 
+// byte offset of a member of a standard layout type, the object is never constructed
+template <typename T, typename M>
+size_t MemberOffset(M T::*member)
+{
+    static_assert(std::is_standard_layout<T>::value, "T must be a standard layout type!");
+    const typename std::aligned_storage<sizeof(T), alignof(T)>::type storage = {};
+    const auto *object = reinterpret_cast<const T*>(&storage);
+    return static_cast<size_t>(reinterpret_cast<const char*>(&(object->*member)) - reinterpret_cast<const char*>(object));
+}
+
 } // namepsace Impl
 
 template <typename T>
@@ -471,32 +508,42 @@ std::vector<Layer> EnumerateLayers();
 std::vector<Extension> EnumerateExtensions(const std::string &layerName = {});
 
 class BufferView;
+struct DescriptorBufferInfo;
+struct DescriptorImageInfo;
 class DescriptorSet;
 class DescriptorSetLayout;
+class DescriptorUpdateTemplate;
+class Device;
 class DeviceMemory;
 class Event;
 class Fence;
 class Framebuffer;
 class Image;
 class ImageView;
+class PhysicalDevice;
 class PipelineCache;
+class PipelineManifest;
 class PipelineLayout;
+class PresentBatch;
 class QueryPool;
 class Queue;
 class RenderPass;
 class Sampler;
 class Semaphore;
 class ShaderModule;
+class SubmitBatch;
 class Surface;
 class Swapchain;
 
-struct SpecializationInfo
+// owns its map entries, the base is what the pipeline gets
+struct SpecializationInfo : VkSpecializationInfo
 {
-    SpecializationInfo() = default;
+    SpecializationInfo()
+        : VkSpecializationInfo{0, nullptr, 0, nullptr} {}
 
     template<typename T>
     SpecializationInfo(const T *pData, size_t entryCount)
-        : dataSize(sizeof(T) * entryCount), pData(pData)
+        : VkSpecializationInfo{0, nullptr, sizeof(T) * entryCount, pData}
     {
         for (size_t i = 0; i < entryCount; ++i) { AppendEntry<T>(false); }
         UpdateEntryData();
@@ -504,21 +551,21 @@ struct SpecializationInfo
 
     template<typename T>
     explicit SpecializationInfo(const T &pData)
-        : entries({{0, 0, sizeof(T)}}), dataSize(sizeof(T)), pData(&pData)
+        : VkSpecializationInfo{0, nullptr, sizeof(T), &pData}, entries({{0, 0, sizeof(T)}})
     {
         UpdateEntryData();
     }
 
     template<typename T>
     explicit SpecializationInfo(const Span<T> &entries)
-        : dataSize(sizeof(T) * entries.size()), pData(entries.data())
+        : VkSpecializationInfo{0, nullptr, sizeof(T) * entries.size(), entries.data()}
     {
         for (const auto &e : entries) { AppendEntry<T>(false); }
         UpdateEntryData();
     }
 
     SpecializationInfo(const void *pData, size_t dataSize, const Span<VkSpecializationMapEntry> &entries)
-        : entries(entries.begin(), entries.end()), dataSize(dataSize), pData(pData)
+        : VkSpecializationInfo{0, nullptr, dataSize, pData}, entries(entries.begin(), entries.end())
     {
         UpdateEntryData();
     }
@@ -569,14 +616,6 @@ private:
         pMapEntries = entries.data();
     }
 
-    uint32_t mapEntryCount = 0;
-    const VkSpecializationMapEntry *pMapEntries = nullptr;
-
-public:
-    size_t dataSize = 0;
-    const void *pData = nullptr;
-
-private:
     std::vector<VkSpecializationMapEntry> entries;
 }; // struct SpecializationInfo
 
@@ -597,6 +636,113 @@ SpecializationInfo CreateSpecializationInfo(const void *pData)
     return specializationInfo;
 }
 
+// Specialization constants of the types Ts stored in the object itself, bool is stored as VkBool32.
+// The layout of the data and the map entries is computed at compile time, nothing is allocated.
+// Constant IDs are 0 to N - 1 unless they are given explicitly.
+template <typename... Ts>
+class Specialization
+{
+public:
+
+    static constexpr uint32_t Count = sizeof...(Ts);
+
+    template <size_t I>
+    using Type = typename std::tuple_element<I, std::tuple<Ts...>>::type;
+
+    explicit Specialization(const Ts&... values)
+        : Specialization(std::index_sequence_for<Ts...>(), MakeDefaultConstantIDs(std::index_sequence_for<Ts...>()), values...) {}
+
+    Specialization(const std::array<uint32_t, Count> &constantIDs, const Ts&... values)
+        : Specialization(std::index_sequence_for<Ts...>(), constantIDs, values...) {}
+
+    Specialization(const Specialization &other)
+        : data_(other.data_), entries_(other.entries_)
+    {
+        UpdateInfo();
+    }
+
+    Specialization& operator=(const Specialization &other)
+    {
+        data_ = other.data_;
+        entries_ = other.entries_;
+        return *this;
+    }
+
+    template <size_t I>
+    void Set(const Type<I> &value)
+    {
+        const Storage<Type<I>> storage = value;
+        std::memcpy(data_.data() + OFFSETS[I], &storage, sizeof(storage));
+    }
+
+    template <size_t I>
+    Type<I> Get() const
+    {
+        Storage<Type<I>> storage;
+        std::memcpy(&storage, data_.data() + OFFSETS[I], sizeof(storage));
+        return static_cast<Type<I>>(storage);
+    }
+
+    // points into the object
+    const SpecializationInfo& GetInfo() const
+    {
+        return info_;
+    }
+
+private:
+
+    template <typename T>
+    using Storage = typename std::conditional<std::is_same<T, bool>::value, VkBool32, T>::type;
+
+    static_assert(Count > 0, "A specialization needs at least one constant!");
+    static_assert(std::conjunction<std::is_arithmetic<Ts>...>::value, "Specialization constants must be scalars!");
+
+    // every constant at the next offset aligned to its size
+    static constexpr std::array<uint32_t, Count> MakeOffsets()
+    {
+        const uint32_t sizes[] = {static_cast<uint32_t>(sizeof(Storage<Ts>))...};
+        std::array<uint32_t, Count> offsets = {};
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < Count; ++i)
+        {
+            offset = (offset + sizes[i] - 1) / sizes[i] * sizes[i];
+            offsets[i] = offset;
+            offset += sizes[i];
+        }
+        return offsets;
+    }
+
+    static constexpr std::array<uint32_t, Count> OFFSETS = MakeOffsets();
+    static constexpr uint32_t DATA_SIZE = OFFSETS[Count - 1] + static_cast<uint32_t>(sizeof(Storage<Type<Count - 1>>));
+
+    template <size_t... I>
+    static constexpr std::array<uint32_t, Count> MakeDefaultConstantIDs(std::index_sequence<I...>)
+    {
+        return {static_cast<uint32_t>(I)...};
+    }
+
+    template <size_t... I>
+    Specialization(std::index_sequence<I...>, const std::array<uint32_t, Count> &constantIDs, const Ts&... values)
+        : entries_{{{constantIDs[I], OFFSETS[I], sizeof(Storage<Ts>)}...}}
+    {
+        (Set<I>(values), ...);
+        UpdateInfo();
+    }
+
+    // the info does not own the entries, copies point to their own storage
+    void UpdateInfo()
+    {
+        info_.mapEntryCount = Count;
+        info_.pMapEntries = entries_.data();
+        info_.dataSize = DATA_SIZE;
+        info_.pData = data_.data();
+    }
+
+    alignas(8) std::array<uint8_t, DATA_SIZE> data_ = {};
+    std::array<VkSpecializationMapEntry, Count> entries_;
+    SpecializationInfo info_;
+}; // class Specialization
+
 class ShaderModule
 {
 public:
@@ -630,6 +776,49 @@ private:
     Impl::NonDispatchableObject<VkShaderModule, VkDevice, vkDestroyShaderModule> shaderModule_;
 }; // class ShaderModule
 
+// Creates every distinct SPIR-V module once and shares it. Modules are identified by a 64 bit hash of their code, the code is kept
+// and compared on a hit so that a collision cannot return a wrong module.
+// Files are memory mapped only while their module is created and each path is read once. Thread safe.
+// Shader modules are not needed once the pipelines using them have been created, ReleaseUnused destroys them.
+class ShaderLibrary
+{
+public:
+
+    explicit ShaderLibrary(const Device &device);
+    ShaderLibrary(const ShaderLibrary &other) = delete;
+    ShaderLibrary& operator=(const ShaderLibrary &other) = delete;
+
+    // returns nullptr if the file cannot be read
+    std::shared_ptr<const ShaderModule> Load(const std::string &path);
+    std::shared_ptr<const ShaderModule> Get(const Span<uint32_t> &code);
+    // returns nullptr if no module with the hash has been loaded
+    std::shared_ptr<const ShaderModule> Find(uint64_t hash) const;
+
+    // destroys the modules which are only referenced by the library
+    void ReleaseUnused();
+
+    // the hash modules are identified by, also used by PipelineManifest
+    static uint64_t Hash(const Span<uint32_t> &code);
+
+    size_t GetSize() const;
+
+private:
+
+    struct Entry
+    {
+        std::vector<uint32_t> code;
+        std::shared_ptr<const ShaderModule> module;
+    };
+
+    std::shared_ptr<const ShaderModule> Get(uint64_t hash, const Span<uint32_t> &code);
+
+    std::shared_ptr<const Device> device_;
+    mutable std::mutex mutex_;
+    // by code hash
+    std::unordered_map<uint64_t, Entry> modules_;
+    std::unordered_map<std::string, uint64_t> paths_;
+}; // class ShaderLibrary
+
 class Pipeline
 {
 public:
@@ -666,20 +855,20 @@ public:
 
         ShaderStage(const ShaderModule &module, std::string entryPointName,
                     VkShaderStageFlagBits stage, VkPipelineShaderStageCreateFlags flags = 0,
-                    SpecializationInfo *pSpecializationInfo = nullptr)
+                    const SpecializationInfo *pSpecializationInfo = nullptr)
             : module(&module), entryPointName(std::move(entryPointName)), stage(stage), flags(flags)
             , pSpecializationInfo(pSpecializationInfo) {}
 
         ShaderStage(const void *pNext, const ShaderModule &module, std::string entryPointName,
                     VkShaderStageFlagBits stage, VkPipelineShaderStageCreateFlags flags = 0,
-                    SpecializationInfo *pSpecializationInfo = nullptr)
+                    const SpecializationInfo *pSpecializationInfo = nullptr)
             : pNext(pNext), module(&module), entryPointName(std::move(entryPointName)), stage(stage)
             , flags(flags), pSpecializationInfo(pSpecializationInfo) {}
 
         explicit operator VkPipelineShaderStageCreateInfo() const
         {
             return {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, pNext, flags, stage,
-                    VkShaderModule(*module), entryPointName.c_str(), reinterpret_cast<VkSpecializationInfo*>(pSpecializationInfo)};
+                    VkShaderModule(*module), entryPointName.c_str(), pSpecializationInfo};
         }
 
         const void *pNext = nullptr;
@@ -687,7 +876,7 @@ public:
         VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
         const ShaderModule *module = nullptr;
         std::string entryPointName;
-        SpecializationInfo *pSpecializationInfo = nullptr;
+        const SpecializationInfo *pSpecializationInfo = nullptr;
     }; // struct PipelineShaderStage
 
     struct VertexInputState
@@ -924,6 +1113,93 @@ private:
     Impl::NonDispatchableObject<VkPipeline, VkDevice, vkDestroyPipeline> pipeline_;
 }; // class Pipeline
 
+// Interface of a SPIR-V module as passed to Device::CreateShaderModule, read in a single pass over the instructions.
+// Only the first entry point of the module is reflected. Reflections of the stages of a pipeline are merged into one
+// which provides the layouts of the pipeline, created through the interning caches of the device.
+class ShaderReflection
+{
+public:
+
+    struct SpecializationConstant
+    {
+        uint32_t constantID;
+        uint32_t size;
+        // bit pattern of the default value
+        uint64_t defaultValue;
+    };
+
+    struct VertexInput
+    {
+        uint32_t location;
+        VkFormat format;
+    };
+
+    ShaderReflection() = default;
+    explicit ShaderReflection(const Span<uint32_t> &code);
+    explicit ShaderReflection(const Span<char> &code);
+
+    // false if the code is not a valid SPIR-V module
+    explicit operator bool() const
+    {
+        return stages_ != 0;
+    }
+
+    // adds the interface of another stage of the same pipeline
+    ShaderReflection& Merge(const ShaderReflection &other);
+
+    VkShaderStageFlags GetStages() const
+    {
+        return stages_;
+    }
+
+    // bindings per set sorted by binding, runtime arrays have a descriptorCount of 0
+    const std::vector<std::vector<VkDescriptorSetLayoutBinding>>& GetDescriptorSetLayoutBindings() const
+    {
+        return sets_;
+    }
+
+    const std::vector<VkPushConstantRange>& GetPushConstantRanges() const
+    {
+        return pushConstantRanges_;
+    }
+
+    // sorted by constantID
+    const std::vector<SpecializationConstant>& GetSpecializationConstants() const
+    {
+        return specializationConstants_;
+    }
+
+    // inputs of the vertex stage sorted by location
+    const std::vector<VertexInput>& GetVertexInputs() const
+    {
+        return vertexInputs_;
+    }
+
+    // all vertex inputs tightly packed in location order into a single binding
+    Pipeline::VertexInputState GetVertexInputState(uint32_t binding = 0, VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX) const;
+
+    // of the compute stage
+    const std::array<uint32_t, 3>& GetWorkgroupSize() const
+    {
+        return workgroupSize_;
+    }
+
+    // the object caches of the device must be enabled, equal layouts of different pipelines are the same objects.
+    // Sets with runtime arrays cannot be created from the reflection alone, their layouts have to be created by the caller
+    // from GetDescriptorSetLayoutBindings with a descriptorCount and VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT
+    const DescriptorSetLayout& GetDescriptorSetLayout(const Device &device, uint32_t set) const;
+    const PipelineLayout& GetPipelineLayout(const Device &device) const;
+
+private:
+
+    VkShaderStageFlags stages_ = 0;
+    std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets_;
+    std::vector<VkPushConstantRange> pushConstantRanges_;
+    std::vector<SpecializationConstant> specializationConstants_;
+    std::vector<VertexInput> vertexInputs_;
+    std::array<uint32_t, 3> workgroupSize_ = {};
+}; // class ShaderReflection
+
 struct GraphicsPipelineStateDescription
 {
     GraphicsPipelineStateDescription() = default;
@@ -939,6 +1215,31 @@ struct GraphicsPipelineStateDescription
     Pipeline::DynamicState *dynamicState = nullptr;
 };
 
+// Describes one pipeline of a batch, basePipelineIndex refers to an earlier description of the same batch or is -1.
+// The derivative flags are added for base pipelines and their derivatives.
+struct GraphicsPipelineDescription
+{
+    GraphicsPipelineDescription() = default;
+
+    const RenderPass *renderPass = nullptr;
+    uint32_t subpass = 0;
+    std::vector<Pipeline::ShaderStage> stages;
+    const PipelineLayout *layout = nullptr;
+    GraphicsPipelineStateDescription state;
+    VkPipelineCreateFlags flags = 0;
+    int32_t basePipelineIndex = -1;
+};
+
+struct ComputePipelineDescription
+{
+    ComputePipelineDescription() = default;
+
+    Pipeline::ShaderStage stage;
+    const PipelineLayout *layout = nullptr;
+    VkPipelineCreateFlags flags = 0;
+    int32_t basePipelineIndex = -1;
+};
+
 class PipelineCache
 {
 public:
@@ -976,6 +1277,307 @@ private:
     Impl::NonDispatchableObject<VkPipelineCache, VkDevice, vkDestroyPipelineCache> pipelineCache_;
 }; // class PipelineCache
 
+// Keeps a pipeline cache in a file. The file is memory mapped on load and discarded if it is corrupt or has been
+// written by a different device or driver. Saving writes a temporary file and flushes it to the disk before it replaces the previous one.
+class PipelineCacheStore
+{
+public:
+
+    // optional compression of the stored data, decompress must fill exactly dstSize bytes or return false
+    struct Codec
+    {
+        std::function<std::vector<char>(const char *pData, size_t dataSize)> compress;
+        std::function<bool(const char *pData, size_t dataSize, char *pDst, size_t dstSize)> decompress;
+    };
+
+    PipelineCacheStore(const Device &device, const PhysicalDevice &physicalDevice, std::string path, Codec codec = {});
+    ~PipelineCacheStore();
+    PipelineCacheStore(const PipelineCacheStore &other) = delete;
+    PipelineCacheStore& operator=(const PipelineCacheStore &other) = delete;
+
+    const PipelineCache& GetCache() const
+    {
+        return cache_;
+    }
+
+    // true if the cache has been created from the data in the file
+    bool IsLoaded() const
+    {
+        return loaded_;
+    }
+
+    // returns false if the file could not be written
+    bool Save();
+    // the cache data is retrieved on the calling thread, compressing and writing it happens on a background thread,
+    // a save which is still in progress is waited for first
+    void SaveAsync();
+    // waits for a pending SaveAsync and returns whether the last save succeeded
+    bool WaitForSave();
+
+private:
+
+    bool Write(const std::vector<char> &data) const;
+
+    std::string path_;
+    Codec codec_;
+    PipelineCache cache_;
+    bool loaded_ = false;
+    bool saveResult_ = true;
+    std::thread saveThread_;
+}; // class PipelineCacheStore
+
+// Compiles batches of pipelines on a pool of worker threads. Every worker compiles into its own pipeline cache which is
+// seeded with the contents of the target cache, Merge combines the worker caches into the target cache again.
+// A base pipeline and its derivatives are compiled together by one worker.
+class PipelineCompiler
+{
+public:
+
+    // the target cache is optional and must outlive the compiler, threadCount 0 uses one thread per hardware thread
+    explicit PipelineCompiler(const Device &device, const PipelineCache &pipelineCache = {}, uint32_t threadCount = 0);
+    ~PipelineCompiler();
+    PipelineCompiler(const PipelineCompiler &other) = delete;
+    PipelineCompiler& operator=(const PipelineCompiler &other) = delete;
+
+    // the descriptions are copied, the objects they point to must stay valid until the pipelines have been compiled,
+    // the futures rethrow the error if compiling a pipeline failed. Pipelines which were not created, e.g. because of
+    // VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT, throw an Exception with VK_PIPELINE_COMPILE_REQUIRED_EXT
+    std::vector<std::future<Pipeline>> CompileGraphicsPipelines(const Span<GraphicsPipelineDescription> &descriptions);
+    std::vector<std::future<Pipeline>> CompileComputePipelines(const Span<ComputePipelineDescription> &descriptions);
+    // runs a custom creation with the cache of a worker, e.g. linking pipeline libraries, an empty pipeline is reported like above
+    std::future<Pipeline> Submit(std::function<Pipeline(const Device &device, const PipelineCache &pipelineCache)> create);
+
+    // waits until all batches have been compiled
+    void Wait();
+    // waits and merges the worker caches into the target cache
+    void Merge();
+
+private:
+
+    using Job = std::function<void(const PipelineCache&)>;
+
+    template <typename T, typename F>
+    std::vector<std::future<Pipeline>> Compile(const Span<T> &descriptions, F &&create);
+    void Run(uint32_t workerIndex);
+
+    std::shared_ptr<const Device> device_;
+    const PipelineCache *pipelineCache_;
+    std::vector<PipelineCache> workerCaches_;
+
+    bool stop_ = false;
+    uint32_t pendingJobs_ = 0;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable idleCv_;
+    std::deque<Job> jobs_;
+    std::vector<std::thread> threads_;
+}; // class PipelineCompiler
+
+// Canonical form of the complete state of a pipeline with a 64 bit hash. Objects are identified by their handles,
+// render passes and pipeline layouts should come from the interning caches of the device so compatible objects produce equal keys.
+// State which is dynamic in the description does not take part, this covers the core dynamic states and those of VK_EXT_extended_dynamic_state
+// except the primitive topology, whose class still matters. The states of VK_EXT_extended_dynamic_state2 and 3 are keyed with their static values.
+// pNext chains are not supported, the constructors throw an Exception with VK_ERROR_FEATURE_NOT_PRESENT.
+class PipelineKey
+{
+public:
+
+    PipelineKey() = default;
+    explicit PipelineKey(const GraphicsPipelineDescription &description);
+    // only the state which belongs to the given parts of a graphics pipeline library, see GraphicsPipelineLibrary
+    PipelineKey(const GraphicsPipelineDescription &description, VkGraphicsPipelineLibraryFlagsEXT parts);
+    explicit PipelineKey(const ComputePipelineDescription &description);
+
+    uint64_t GetHash() const
+    {
+        return hash_;
+    }
+
+    bool operator== (const PipelineKey &other) const
+    {
+        return hash_ == other.hash_ && data_ == other.data_;
+    }
+
+    bool operator!= (const PipelineKey &other) const
+    {
+        return !(*this == other);
+    }
+
+    struct Hash
+    {
+        size_t operator()(const PipelineKey &key) const
+        {
+            return static_cast<size_t>(key.hash_);
+        }
+    };
+
+private:
+
+    void AppendStage(const Pipeline::ShaderStage &stage);
+
+    std::string data_;
+    uint64_t hash_ = 0;
+}; // class PipelineKey
+
+// Thread safe cache of pipelines by their PipelineKey. A pipeline which is requested concurrently is compiled once,
+// the other requests wait for it, if compiling fails the next request tries again.
+// Lookups of pipelines which are already cached only take a shared lock.
+class PipelineStateCache
+{
+public:
+
+    // the pipeline cache is optional and must outlive the state cache
+    explicit PipelineStateCache(const Device &device, const PipelineCache &pipelineCache = {});
+    PipelineStateCache(const PipelineStateCache &other) = delete;
+    PipelineStateCache& operator=(const PipelineStateCache &other) = delete;
+
+    // basePipelineIndex must be -1, the returned pipeline lives as long as the cache
+    const Pipeline& Get(const GraphicsPipelineDescription &description);
+    const Pipeline& Get(const ComputePipelineDescription &description);
+
+    size_t GetSize() const;
+
+private:
+
+    struct Entry
+    {
+        std::once_flag compiled;
+        Pipeline pipeline;
+    };
+
+    template <typename T>
+    const Pipeline& Get(const T &description);
+
+    std::shared_ptr<const Device> device_;
+    const PipelineCache *pipelineCache_;
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<PipelineKey, std::unique_ptr<Entry>, PipelineKey::Hash> entries_;
+}; // class PipelineStateCache
+
+// Hands out pipelines without blocking the calling thread. Pipelines which are not ready yet are compiled by the PipelineCompiler
+// and the fallback chosen by the caller, e.g. a generic variant, is returned until they are.
+// With probeCache, which requires the pipelineCreationCacheControl feature, pipelines found in the pipeline cache are created
+// right away and only real cache misses are compiled in the background. The provider does not merge the compiler, pipelines it
+// compiled reach the pipeline cache and with it the probes once the owner calls PipelineCompiler::Merge while no thread is in Get,
+// e.g. between levels. The compiler should use the pipeline cache of the provider as its target cache.
+class AsyncPipelineProvider
+{
+public:
+
+    // the compiler and the pipeline cache must outlive the provider
+    AsyncPipelineProvider(const Device &device, PipelineCompiler &compiler, const PipelineCache &pipelineCache = {}, bool probeCache = false);
+    AsyncPipelineProvider(const AsyncPipelineProvider &other) = delete;
+    AsyncPipelineProvider& operator=(const AsyncPipelineProvider &other) = delete;
+
+    // returns the requested pipeline once it has been compiled and the fallback until then, basePipelineIndex must be -1.
+    // The state the description points to is copied for the compiler, the render pass, the pipeline layout and the shader modules
+    // must stay valid until the pipeline has been compiled. If compiling failed the fallback keeps being returned, see GetError
+    const Pipeline& Get(const GraphicsPipelineDescription &description, const Pipeline &fallback);
+    const Pipeline& Get(const ComputePipelineDescription &description, const Pipeline &fallback);
+
+    // the error thrown while compiling the pipeline, nullptr if it has been compiled, is still pending or has not been requested
+    std::exception_ptr GetError(const GraphicsPipelineDescription &description) const;
+    std::exception_ptr GetError(const ComputePipelineDescription &description) const;
+
+    // number of pipelines which are being compiled
+    size_t GetPendingCount() const
+    {
+        return pendingCount_.load();
+    }
+
+private:
+
+    // entries are never erased, so pointers to them stay valid without the map lock
+    struct Entry
+    {
+        std::atomic<bool> ready = {false};
+        Pipeline pipeline;
+        // set once error has been stored, the entry is not compiled again
+        std::atomic<bool> failed = {false};
+        std::exception_ptr error;
+        // guards the future
+        std::mutex mutex;
+        std::future<Pipeline> future;
+    };
+
+    template <typename T>
+    const Pipeline& Get(const T &description, const Pipeline &fallback);
+    template <typename T>
+    std::exception_ptr GetError(const T &description) const;
+    Pipeline Probe(const GraphicsPipelineDescription &description) const;
+    Pipeline Probe(const ComputePipelineDescription &description) const;
+    std::future<Pipeline> Compile(const GraphicsPipelineDescription &description);
+    std::future<Pipeline> Compile(const ComputePipelineDescription &description);
+
+    std::shared_ptr<const Device> device_;
+    PipelineCompiler *compiler_;
+    const PipelineCache *pipelineCache_;
+    const bool probeCache_;
+    std::atomic<size_t> pendingCount_ = {0};
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<PipelineKey, std::unique_ptr<Entry>, PipelineKey::Hash> entries_;
+}; // class AsyncPipelineProvider
+
+// Graphics pipelines assembled from the four parts of VK_EXT_graphics_pipeline_library: vertex input interface, pre-rasterization shaders,
+// fragment shader and fragment output interface. Every part is created once per distinct state and cached, so a pipeline which only
+// differs from a known one in e.g. its blend state links already compiled parts instead of compiling all stages again. With a compiler
+// the pipeline is also linked with link time optimization in the background and replaces the fast linked one once it is ready.
+// The graphicsPipelineLibrary feature has to be enabled. Thread safe.
+class GraphicsPipelineLibrary
+{
+public:
+
+    // the compiler is optional, the compiler and the pipeline cache must outlive the library
+    explicit GraphicsPipelineLibrary(const Device &device, PipelineCompiler *compiler = nullptr, const PipelineCache &pipelineCache = {});
+    // waits for the optimized pipelines which are being linked
+    ~GraphicsPipelineLibrary();
+    GraphicsPipelineLibrary(const GraphicsPipelineLibrary &other) = delete;
+    GraphicsPipelineLibrary& operator=(const GraphicsPipelineLibrary &other) = delete;
+
+    // basePipelineIndex must be -1 and the objects the description points to must outlive the library.
+    // The returned pipeline lives as long as the library, once the optimized pipeline is ready it is returned instead
+    const Pipeline& Get(const GraphicsPipelineDescription &description);
+
+    // number of cached libraries over all parts
+    size_t GetPartCount() const;
+
+    // number of optimized pipelines which are being linked
+    size_t GetPendingCount() const
+    {
+        return pendingCount_.load();
+    }
+
+private:
+
+    struct Part
+    {
+        std::once_flag created;
+        Pipeline library;
+    };
+
+    struct Entry
+    {
+        std::once_flag linked;
+        Pipeline pipeline;
+        std::mutex mutex; // guards the future
+        std::atomic<bool> pending = {false};
+        std::atomic<bool> optimized = {false};
+        Pipeline optimizedPipeline;
+        std::future<Pipeline> future;
+    };
+
+    const Pipeline& GetPart(VkGraphicsPipelineLibraryFlagBitsEXT part, const GraphicsPipelineDescription &description);
+    void Link(const GraphicsPipelineDescription &description, Entry &entry);
+
+    std::shared_ptr<const Device> device_;
+    PipelineCompiler *compiler_;
+    const PipelineCache *pipelineCache_;
+    std::atomic<size_t> pendingCount_ = {0};
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<PipelineKey, std::unique_ptr<Part>, PipelineKey::Hash> parts_;
+    std::unordered_map<PipelineKey, std::unique_ptr<Entry>, PipelineKey::Hash> entries_;
+}; // class GraphicsPipelineLibrary
+
 
 class Buffer
 {
@@ -1184,6 +1786,25 @@ public:
         PushConstants(layout, stageFlags, &values, offset, sizeof(T));
     }
 
+    // VK_KHR_push_descriptor: the descriptors are recorded into the command buffer, no set has to be allocated.
+    // The device which the command buffer belongs to has to have the extension enabled.
+    void PushDescriptorSet(const Device &device, VkPipelineBindPoint pipelineBindPoint, const PipelineLayout &layout, uint32_t set, const Span<VkWriteDescriptorSet> &descriptorWrites) const;
+    void PushDescriptorSet(const Device &device, VkPipelineBindPoint pipelineBindPoint, const PipelineLayout &layout, uint32_t set, uint32_t binding,
+                           VkDescriptorType descriptorType, const Span<DescriptorBufferInfo> &bufferInfo) const;
+    void PushDescriptorSet(const Device &device, VkPipelineBindPoint pipelineBindPoint, const PipelineLayout &layout, uint32_t set, uint32_t binding,
+                           VkDescriptorType descriptorType, const Span<DescriptorImageInfo> &imageInfo) const;
+    void PushDescriptorSet(const Device &device, VkPipelineBindPoint pipelineBindPoint, const PipelineLayout &layout, uint32_t set, uint32_t binding,
+                           VkDescriptorType descriptorType, const Span2<BufferView> &bufferViews) const;
+    // the template has been created with Device::CreatePushDescriptorUpdateTemplate
+    void PushDescriptorSetWithTemplate(const Device &device, const DescriptorUpdateTemplate &updateTemplate, const PipelineLayout &layout, uint32_t set,
+                                       const void *pData) const;
+
+    template <typename T>
+    void PushDescriptorSet(const Device &device, const DescriptorUpdateTemplate &updateTemplate, const PipelineLayout &layout, uint32_t set, const T &data) const
+    {
+        PushDescriptorSetWithTemplate(device, updateTemplate, layout, set, &data);
+    }
+
     void SetViewport(const VkViewport &viewport, uint32_t firstViewport = 0) const;
     void SetViewports(const Span<VkViewport> &viewports, uint32_t firstViewport = 0) const;
     void SetScissor(const VkRect2D &scissor, uint32_t firstScissor = 0) const;
@@ -1309,6 +1930,8 @@ public:
 
     DescriptorSet AllocateDescriptorSet(const DescriptorSetLayout &setLayout) const;
     DescriptorSet AllocateDescriptorSetExt(const void *pNext, const DescriptorSetLayout &setLayout) const;
+    // the last binding of the layout has VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT set
+    DescriptorSet AllocateDescriptorSet(const DescriptorSetLayout &setLayout, uint32_t variableDescriptorCount) const;
     std::vector<DescriptorSet> AllocateDescriptorSets(const Span2<DescriptorSetLayout> &setLayouts) const;
     std::vector<DescriptorSet> AllocateDescriptorSetsExt(const void *pNext, const Span2<DescriptorSetLayout> &setLayouts) const;
 
@@ -1319,6 +1942,59 @@ private:
 
 }; // class DescriptorPool
 
+// Allocates descriptor sets from chains of pools which grow on demand. Every frame in flight owns one chain per thread,
+// BeginFrame resets all pools of the frame that is reused as a whole, so sets are never freed individually.
+// A thread only ever uses its own chain, so allocations do not lock.
+class DescriptorAllocator
+{
+public:
+
+    // average number of descriptors of a type per set
+    struct PoolSizeRatio
+    {
+        VkDescriptorType type;
+        float ratio;
+    };
+
+    DescriptorAllocator() = default;
+    // each new pool of a chain holds growthFactor times the sets of the previous one, up to maxSetsPerPool
+    DescriptorAllocator(const Device &device, uint32_t frameCount, uint32_t threadCount, const Span<PoolSizeRatio> &poolSizeRatios,
+                        uint32_t initialSetsPerPool = 64, float growthFactor = 2.0f, uint32_t maxSetsPerPool = 4096);
+
+    // advances to the next frame and resets its pools, the GPU must have finished using them
+    // must not be called concurrently with Allocate
+    void BeginFrame();
+
+    DescriptorSet Allocate(const DescriptorSetLayout &setLayout, uint32_t threadIndex = 0);
+    DescriptorSet AllocateExt(const void *pNext, const DescriptorSetLayout &setLayout, uint32_t threadIndex = 0);
+
+    uint32_t GetFrameIndex() const
+    {
+        return frameIndex_;
+    }
+
+private:
+
+    struct PoolChain
+    {
+        std::vector<DescriptorPool> pools;
+        // pools before current are exhausted
+        size_t current = 0;
+        uint32_t nextSetsPerPool = 0;
+    };
+
+    DescriptorPool CreatePool(uint32_t maxSets) const;
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    uint32_t threadCount_ = 0;
+    uint32_t frameIndex_ = 0;
+    std::vector<PoolSizeRatio> poolSizeRatios_;
+    float growthFactor_ = 2.0f;
+    uint32_t maxSetsPerPool_ = 0;
+    // frameCount * threadCount chains, the chains of one frame are adjacent
+    std::vector<PoolChain> chains_;
+}; // class DescriptorAllocator
+
 class DescriptorSet
 {
 public:
@@ -1384,24 +2060,65 @@ private:
 
 }; // class DescriptorSetLayout
 
-struct DescriptorImageInfo
+class DescriptorUpdateTemplate
 {
-    DescriptorImageInfo() = default;
-    DescriptorImageInfo(const Sampler &sampler, const ImageView &imageView, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_UNDEFINED)
-        : sampler(&sampler), imageView(&imageView), imageLayout(imageLayout)
-    {}
+public:
+    DescriptorUpdateTemplate() = default;
+    explicit DescriptorUpdateTemplate(VkDevice device, VkDescriptorUpdateTemplate descriptorUpdateTemplate)
+        : descriptorUpdateTemplate_(device, descriptorUpdateTemplate) {}
 
-    const Sampler *sampler = nullptr;
-    const ImageView *imageView = nullptr;
-    VkImageLayout imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    explicit operator bool() const
+    {
+        return descriptorUpdateTemplate_ != VK_NULL_HANDLE;
+    }
 
-    explicit operator VkDescriptorImageInfo() const;
-};
+    explicit operator VkDescriptorUpdateTemplate() const
+    {
+        return descriptorUpdateTemplate_;
+    }
 
-struct DescriptorBufferInfo
-{
-    DescriptorBufferInfo() = default;
-    explicit DescriptorBufferInfo(const Buffer &buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE)
+    bool operator==(const DescriptorUpdateTemplate &other) const
+    {
+        return descriptorUpdateTemplate_ == other.descriptorUpdateTemplate_;
+    }
+
+    bool operator!=(const DescriptorUpdateTemplate &other) const
+    {
+        return descriptorUpdateTemplate_ != other.descriptorUpdateTemplate_;
+    }
+
+private:
+    Impl::NonDispatchableObject<VkDescriptorUpdateTemplate, VkDevice, vkDestroyDescriptorUpdateTemplate> descriptorUpdateTemplate_;
+
+}; // class DescriptorUpdateTemplate
+
+// Entry which reads all descriptors of a layout binding from a member of T. The member is a VkDescriptorBufferInfo,
+// VkDescriptorImageInfo or VkBufferView or an array of binding.descriptorCount of them.
+template <typename T, typename M>
+VkDescriptorUpdateTemplateEntry MakeDescriptorUpdateTemplateEntry(const VkDescriptorSetLayoutBinding &binding, M T::*member)
+{
+    assert(binding.descriptorCount > 0 && sizeof(M) % binding.descriptorCount == 0);
+    return {binding.binding, 0, binding.descriptorCount, binding.descriptorType, Impl::MemberOffset(member), sizeof(M) / binding.descriptorCount};
+}
+
+struct DescriptorImageInfo
+{
+    DescriptorImageInfo() = default;
+    DescriptorImageInfo(const Sampler &sampler, const ImageView &imageView, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_UNDEFINED)
+        : sampler(&sampler), imageView(&imageView), imageLayout(imageLayout)
+    {}
+
+    const Sampler *sampler = nullptr;
+    const ImageView *imageView = nullptr;
+    VkImageLayout imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    explicit operator VkDescriptorImageInfo() const;
+};
+
+struct DescriptorBufferInfo
+{
+    DescriptorBufferInfo() = default;
+    explicit DescriptorBufferInfo(const Buffer &buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE)
         : buffer(&buffer), offset(offset), range(range)
     {}
 
@@ -1412,6 +2129,239 @@ struct DescriptorBufferInfo
     explicit operator VkDescriptorBufferInfo() const;
 };
 
+// Accumulates descriptor writes and copies of any number of sets and applies all of them with a single vkUpdateDescriptorSets call.
+// The info arrays live in arenas which keep their capacity between two flushes.
+class DescriptorWriter
+{
+public:
+
+    DescriptorWriter() = default;
+    explicit DescriptorWriter(const Device &device);
+
+    DescriptorWriter& Write(const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement, VkDescriptorType descriptorType,
+                            const Span<DescriptorBufferInfo> &bufferInfo);
+    DescriptorWriter& WriteExt(const void *pNext, const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement,
+                               VkDescriptorType descriptorType, const Span<DescriptorBufferInfo> &bufferInfo);
+    DescriptorWriter& Write(const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement,
+                            VkDescriptorType descriptorType, const Span<DescriptorImageInfo> &imageInfo);
+    DescriptorWriter& WriteExt(const void *pNext, const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement,
+                               VkDescriptorType descriptorType, const Span<DescriptorImageInfo> &imageInfo);
+    DescriptorWriter& Write(const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement,
+                            VkDescriptorType descriptorType, const Span2<BufferView> &bufferViews);
+    DescriptorWriter& WriteExt(const void *pNext, const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement,
+                               VkDescriptorType descriptorType, const Span2<BufferView> &bufferViews);
+    DescriptorWriter& Copy(const DescriptorSet &srcSet, uint32_t srcBinding, uint32_t srcStartingArrayElement,
+                           const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement, uint32_t descriptorCount);
+    DescriptorWriter& CopyExt(const void *pNext, const DescriptorSet &srcSet, uint32_t srcBinding, uint32_t srcStartingArrayElement,
+                              const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement, uint32_t descriptorCount);
+    // VK_EXT_inline_uniform_block, the data is copied
+    DescriptorWriter& WriteInlineUniformBlock(const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstByteOffset, const void *pData, uint32_t dataSize);
+
+    bool IsEmpty() const
+    {
+        return writes_.empty() && copies_.empty();
+    }
+
+    // applies all pending writes and copies, writes are applied before copies
+    void Flush();
+    // discards all pending writes and copies
+    void Clear();
+
+private:
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    std::vector<VkWriteDescriptorSet> writes_;
+    // offset of the first info of each write into the arena selected by its descriptor type
+    std::vector<size_t> infoOffsets_;
+    std::vector<VkCopyDescriptorSet> copies_;
+    std::vector<VkDescriptorBufferInfo> bufferInfos_;
+    std::vector<VkDescriptorImageInfo> imageInfos_;
+    std::vector<VkBufferView> bufferViews_;
+    std::vector<VkWriteDescriptorSetInlineUniformBlockEXT> inlineUniformBlocks_;
+    std::vector<size_t> inlineUniformBlockDataOffsets_;
+    std::vector<uint8_t> inlineUniformBlockData_;
+}; // class DescriptorWriter
+
+// Returns the same descriptor set for equal contents instead of allocating and writing a new one.
+// Sets are evicted least recently used first, but only once the frames which may still use them have completed.
+// Sets referencing a Buffer, BufferView or ImageView must be invalidated before it is destroyed. Not thread safe.
+class DescriptorSetCache
+{
+public:
+
+    // layout and contents of a set, equal keys map to the same set
+    class Key
+    {
+    public:
+
+        Key() = default;
+        explicit Key(const DescriptorSetLayout &setLayout);
+
+        Key& Bind(uint32_t binding, VkDescriptorType descriptorType, const Span<DescriptorBufferInfo> &bufferInfo);
+        Key& Bind(uint32_t binding, VkDescriptorType descriptorType, const Span<DescriptorImageInfo> &imageInfo);
+        Key& Bind(uint32_t binding, VkDescriptorType descriptorType, const Span2<BufferView> &bufferViews);
+
+        // starts a new key, the arrays keep their capacity
+        void Reset(const DescriptorSetLayout &setLayout);
+
+        size_t GetHash() const
+        {
+            return hash_;
+        }
+
+        bool operator==(const Key &other) const;
+
+    private:
+
+        friend class DescriptorSetCache;
+
+        struct Binding
+        {
+            uint32_t binding;
+            VkDescriptorType descriptorType;
+            uint32_t offset;
+            uint32_t descriptorCount;
+        };
+
+        void AppendBinding(uint32_t binding, VkDescriptorType descriptorType, size_t offset, uint32_t descriptorCount);
+
+        VkDescriptorSetLayout setLayout_ = VK_NULL_HANDLE;
+        std::vector<Binding> bindings_;
+        std::vector<VkDescriptorBufferInfo> bufferInfos_;
+        std::vector<VkDescriptorImageInfo> imageInfos_;
+        std::vector<VkBufferView> bufferViews_;
+        size_t hash_ = 0;
+    }; // class Key
+
+    DescriptorSetCache() = default;
+    // a set is evictable once frameCount frames have begun since it has been used last
+    DescriptorSetCache(const Device &device, uint32_t maxSets, const Span<VkDescriptorPoolSize> &poolSizes, uint32_t frameCount);
+    DescriptorSetCache(const DescriptorSetCache &other) = delete;
+    DescriptorSetCache& operator=(const DescriptorSetCache &other) = delete;
+
+    // returns the cached set or allocates and writes a new one
+    DescriptorSet Get(const Key &key);
+    // frees invalidated and evicted sets which are no longer in use
+    void BeginFrame();
+
+    void Invalidate(const Buffer &buffer);
+    void Invalidate(const BufferView &bufferView);
+    void Invalidate(const ImageView &imageView);
+
+    size_t GetSize() const
+    {
+        return entries_.size();
+    }
+
+private:
+
+    struct Entry
+    {
+        Key key;
+        VkDescriptorSet descriptorSet;
+        uint64_t lastUsedFrame;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key *key) const
+        {
+            return key->GetHash();
+        }
+    };
+
+    struct KeyEqual
+    {
+        bool operator()(const Key *a, const Key *b) const
+        {
+            return *a == *b;
+        }
+    };
+
+    template <typename F>
+    void InvalidateIf(F references);
+    VkDescriptorSet Allocate(VkDescriptorSetLayout setLayout);
+    bool EvictLeastRecentlyUsed();
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    DescriptorPool pool_;
+    uint64_t frameCount_ = 0;
+    uint64_t frame_ = 0;
+    // most recently used first
+    std::list<Entry> entries_;
+    std::unordered_map<const Key*, std::list<Entry>::iterator, KeyHash, KeyEqual> lookup_;
+    // invalidated sets and the frame they have been used last
+    std::vector<std::pair<VkDescriptorSet, uint64_t>> retired_;
+}; // class DescriptorSetCache
+
+// One global descriptor set with large partially bound arrays of sampled images, storage buffers and samplers,
+// which shaders index directly. Slots are handed out from lock free free lists and written with update after bind,
+// so the set stays bound while resources are added. A removed slot is reused right away, so the GPU must be done with it.
+class BindlessTable
+{
+public:
+
+    enum Binding : uint32_t
+    {
+        SampledImageBinding = 0,
+        StorageBufferBinding = 1,
+        SamplerBinding = 2,
+        BindingCount = 3
+    };
+
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    BindlessTable() = default;
+    BindlessTable(const Device &device, uint32_t maxSampledImages, uint32_t maxStorageBuffers, uint32_t maxSamplers,
+                  VkShaderStageFlags stageFlags = VK_SHADER_STAGE_ALL);
+    BindlessTable(const BindlessTable &other) = delete;
+    BindlessTable& operator=(const BindlessTable &other) = delete;
+
+    const DescriptorSetLayout& GetSetLayout() const
+    {
+        return setLayout_;
+    }
+
+    const DescriptorSet& GetSet() const
+    {
+        return set_;
+    }
+
+    // return the array index of the resource or InvalidIndex if the array is full
+    uint32_t AddSampledImage(const ImageView &imageView, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    uint32_t AddStorageBuffer(const Buffer &buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+    uint32_t AddSampler(const Sampler &sampler);
+
+    void Remove(Binding binding, uint32_t index);
+
+private:
+
+    // Treiber stack of slot indices, the head carries a tag against ABA
+    class FreeList
+    {
+    public:
+
+        void Init(uint32_t count);
+        uint32_t Pop();
+        void Push(uint32_t index);
+
+    private:
+
+        std::unique_ptr<std::atomic<uint32_t>[]> next_;
+        std::atomic<uint64_t> head_ = {0};
+    };
+
+    void Write(const VkWriteDescriptorSet &write);
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    DescriptorSetLayout setLayout_;
+    DescriptorPool pool_;
+    DescriptorSet set_;
+    FreeList freeLists_[BindingCount];
+    // vkUpdateDescriptorSets requires external synchronization of the set
+    std::mutex writeMutex_;
+}; // class BindlessTable
+
 struct ImageDescription
 {
 private:
@@ -1538,11 +2488,36 @@ struct SubpassDependency
 };
 static_assert(sizeof(SubpassDependency) == sizeof(VkSubpassDependency), "sizeof(SubpassDependency) != sizeof(VkSubpassDependency)!");
 
+// Waiting first polls the status with a pause instruction, then polls while yielding the thread
+// and only afterwards blocks in the driver. Avoids the sleep/wake round trip for short GPU jobs.
+struct WaitStrategy
+{
+    WaitStrategy() = default;
+    explicit WaitStrategy(uint64_t spinTimeInNanoSeconds, uint64_t yieldTimeInNanoSeconds = 0, uint32_t pauseCount = 16)
+        : spinTimeInNanoSeconds(spinTimeInNanoSeconds), yieldTimeInNanoSeconds(yieldTimeInNanoSeconds), pauseCount(pauseCount) {}
+
+    uint64_t spinTimeInNanoSeconds = 20000;
+    uint64_t yieldTimeInNanoSeconds = 100000;
+    // pause instructions between two status polls
+    uint32_t pauseCount = 16;
+};
+
 class Device
 {
   public:
     Device() = default;
     explicit Device(VkDevice device);
+    Device(Device &&other) noexcept = default;
+
+    // the cached objects have to be destroyed before the device
+    Device& operator=(Device &&other) noexcept
+    {
+        objectCaches_ = std::move(other.objectCaches_);
+        device_ = std::move(other.device_);
+        pipelineManifest_ = other.pipelineManifest_;
+        pushDescriptorFunctions_ = other.pushDescriptorFunctions_;
+        return *this;
+    }
 
     explicit operator bool() const
     {
@@ -1566,6 +2541,23 @@ class Device
 
     void WaitIdle() const;
 
+    // VK_KHR_push_descriptor entry points of this device, null if the extension is not enabled
+    struct PushDescriptorFunctions
+    {
+        PFN_vkCmdPushDescriptorSetKHR cmdPushDescriptorSet = nullptr;
+        PFN_vkCmdPushDescriptorSetWithTemplateKHR cmdPushDescriptorSetWithTemplate = nullptr;
+    };
+
+    const PushDescriptorFunctions& GetPushDescriptorFunctions() const
+    {
+        return pushDescriptorFunctions_;
+    }
+
+    // Non-owning device with the same handle and state, it never destroys the device. The pipeline and shader helpers keep one
+    // instead of a pointer so they stay valid when the owning Device is moved. The state is copied, so the pipeline manifest
+    // and the object caches have to be set up before the view is taken.
+    Device GetView() const;
+
     Buffer CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBufferCreateFlags flags = 0) const;
     Buffer CreateBufferExt(const void *pNext, VkDeviceSize size, VkBufferUsageFlags usage, VkBufferCreateFlags flags = 0) const;
     Buffer CreateConcurrentBuffer(VkDeviceSize size, VkBufferUsageFlags usage, const Span<uint32_t> &queueFamilyIndices, VkBufferCreateFlags flags = 0) const;
@@ -1622,6 +2614,25 @@ class Device
 
     Sampler CreateSampler(const SamplerDescription &samplerDescription) const;
 
+    // While a manifest is attached every shader module, descriptor set layout, pipeline layout, render pass and pipeline the device
+    // creates is recorded into it. The manifest must outlive the device or be detached with nullptr before it is destroyed.
+    void SetPipelineManifest(PipelineManifest *pipelineManifest)
+    {
+        pipelineManifest_ = pipelineManifest;
+    }
+
+    // Interning caches for objects which are created over and over with the same contents. The Get functions return
+    // the single object created for equal create infos, so equal objects also compare equal. Cached objects live as long as the device.
+    // Has to be called before any Get function and not concurrently with them, the Get functions themselves are thread safe.
+    void EnableObjectCaches();
+    const DescriptorSetLayout& GetDescriptorSetLayout(const Span<VkDescriptorSetLayoutBinding> &bindings, VkDescriptorSetLayoutCreateFlags flags = 0) const;
+    const PipelineLayout& GetPipelineLayout(const Span2<DescriptorSetLayout> &setLayouts, const Span<VkPushConstantRange> &pushConstantRanges = {},
+                                            VkPipelineLayoutCreateFlags flags = 0) const;
+    // samplerDescription.pNext must be nullptr
+    const Sampler& GetSampler(const SamplerDescription &samplerDescription) const;
+    const RenderPass& GetRenderPass(const Span<AttachmentDescription> &attachments, const Span<SubpassDescription> &subpasses,
+                                    const Span<SubpassDependency> &dependencies = {}, VkRenderPassCreateFlags flags = 0) const;
+
     DeviceMemory AllocateMemory(VkDeviceSize allocationSize, uint32_t memoryTypeIndex) const;
     DeviceMemory AllocateMemoryExt(const void *pNext, VkDeviceSize allocationSize, uint32_t memoryTypeIndex) const;
 
@@ -1661,12 +2672,22 @@ class Device
                                    VkPipelineCreateFlags flags = 0, const Pipeline &basePipeline = {}) const;
     Pipeline CreateComputePipelineExt(const void *pNext, const Pipeline::ShaderStage &stage, const PipelineLayout &layout,
                                       const PipelineCache &pipelineCache = {}, VkPipelineCreateFlags flags = 0, const Pipeline &basePipeline = {}) const;
+    // one vkCreateComputePipelines call for all descriptions, the pipelines are returned in the order of the descriptions.
+    // Errors throw, but with VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT the positive VK_PIPELINE_COMPILE_REQUIRED_EXT
+    // is not an error: the pipelines which would have to be compiled are returned empty
+    std::vector<Pipeline> CreateComputePipelines(const Span<ComputePipelineDescription> &descriptions, const PipelineCache &pipelineCache = {}) const;
 
     VkResult WaitForFences(const Span2<Fence> &fences, uint64_t timeoutInNanoSeconds = UINT64_MAX, bool waitAll = true) const;
+    VkResult WaitForFences(const Span2<Fence> &fences, const WaitStrategy &strategy, uint64_t timeoutInNanoSeconds = UINT64_MAX, bool waitAll = true) const;
+    // returns the indices of all signaled fences once at least one of them is signaled, nothing on timeout
+    std::vector<uint32_t> WaitForAnyFence(const Span2<Fence> &fences, uint64_t timeoutInNanoSeconds = UINT64_MAX, const WaitStrategy &strategy = WaitStrategy()) const;
     void ResetFences(const Span2<Fence> &fences) const;
 
     DescriptorSetLayout CreateDescriptorSetLayout(const Span<VkDescriptorSetLayoutBinding> &bindings, VkDescriptorSetLayoutCreateFlags flags = 0) const;
     DescriptorSetLayout CreateDescriptorSetLayoutExt(const void *pNext, const Span<VkDescriptorSetLayoutBinding> &bindings, VkDescriptorSetLayoutCreateFlags flags = 0) const;
+    // descriptor indexing, one VkDescriptorBindingFlags per binding
+    DescriptorSetLayout CreateDescriptorSetLayout(const Span<VkDescriptorSetLayoutBinding> &bindings, const Span<VkDescriptorBindingFlags> &bindingFlags,
+                                                  VkDescriptorSetLayoutCreateFlags flags = 0) const;
 
     PipelineLayout CreatePipelineLayout(const Span2<DescriptorSetLayout> &setLayouts, const Span<VkPushConstantRange> &pushConstantRanges = {},
                                         VkPipelineLayoutCreateFlags flags = 0) const;
@@ -1700,6 +2721,38 @@ class Device
     void UpdateDescriptorSetExt(const void *pNext, const DescriptorSet &srcSet, uint32_t srcBinding, uint32_t srcStartingArrayElement,
                                 const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement, uint32_t descriptorCount = 1) const;
 
+    DescriptorUpdateTemplate CreateDescriptorUpdateTemplate(const Span<VkDescriptorUpdateTemplateEntry> &entries, const DescriptorSetLayout &setLayout,
+                                                            VkDescriptorUpdateTemplateCreateFlags flags = 0) const;
+    DescriptorUpdateTemplate CreateDescriptorUpdateTemplateExt(const void *pNext, const Span<VkDescriptorUpdateTemplateEntry> &entries,
+                                                               const DescriptorSetLayout &setLayout, VkDescriptorUpdateTemplateCreateFlags flags = 0) const;
+
+    // one member of T per binding, in the order of the bindings
+    // e.g. CreateDescriptorUpdateTemplate(setLayout, bindings, &Material::uniforms, &Material::textures)
+    template <typename T, typename... M>
+    DescriptorUpdateTemplate CreateDescriptorUpdateTemplate(const DescriptorSetLayout &setLayout, const Span<VkDescriptorSetLayoutBinding> &bindings,
+                                                            M T::*... members) const
+    {
+        assert(bindings.Count() == sizeof...(M));
+        uint32_t i = 0;
+        const VkDescriptorUpdateTemplateEntry entries[] = {MakeDescriptorUpdateTemplateEntry(bindings[i++], members)...};
+        return CreateDescriptorUpdateTemplate(Span<VkDescriptorUpdateTemplateEntry>(entries, sizeof...(M)), setLayout);
+    }
+
+    void UpdateDescriptorSetWithTemplate(const DescriptorSet &dstSet, const DescriptorUpdateTemplate &updateTemplate, const void *pData) const;
+
+    DescriptorUpdateTemplate CreatePushDescriptorUpdateTemplate(const Span<VkDescriptorUpdateTemplateEntry> &entries, VkPipelineBindPoint pipelineBindPoint,
+                                                                const PipelineLayout &layout, uint32_t set, VkDescriptorUpdateTemplateCreateFlags flags = 0) const;
+
+    // VK_EXT_inline_uniform_block: the data is stored in the set itself, the binding's descriptorCount is its size in bytes.
+    // The pool needs a VkDescriptorPoolInlineUniformBlockCreateInfoEXT, see CreateDescriptorPoolExt.
+    void UpdateInlineUniformBlock(const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstByteOffset, const void *pData, uint32_t dataSize) const;
+
+    template <typename T>
+    void UpdateDescriptorSet(const DescriptorSet &dstSet, const DescriptorUpdateTemplate &updateTemplate, const T &data) const
+    {
+        UpdateDescriptorSetWithTemplate(dstSet, updateTemplate, &data);
+    }
+
     RenderPass CreateRenderPass(const Span<AttachmentDescription> &attachments, const Span<SubpassDescription> &subpasses,
                                 const Span<SubpassDependency> &dependencies, VkRenderPassCreateFlags flags = 0) const;
     RenderPass CreateRenderPassExt(const void *pNext, const Span<AttachmentDescription> &attachments, const Span<SubpassDescription> &subpasses,
@@ -1720,6 +2773,18 @@ class Device
     Pipeline CreateGraphicsPipelineExt(const void *pNext, const RenderPass &renderPass, uint32_t subpass, const Span<Pipeline::ShaderStage> &stages, const PipelineLayout &layout,
                                        const GraphicsPipelineStateDescription &gfxPipeDesc, const PipelineCache &pipelineCache = PipelineCache(),
                                        VkPipelineCreateFlags flags = 0, const Pipeline &basePipeline = {}) const;
+    // one vkCreateGraphicsPipelines call for all descriptions, the pipelines are returned in the order of the descriptions.
+    // Errors throw, but with VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT the positive VK_PIPELINE_COMPILE_REQUIRED_EXT
+    // is not an error: the pipelines which would have to be compiled are returned empty
+    std::vector<Pipeline> CreateGraphicsPipelines(const Span<GraphicsPipelineDescription> &descriptions, const PipelineCache &pipelineCache = {}) const;
+    // VK_EXT_graphics_pipeline_library, creates a library from the state of the description which belongs to the parts.
+    // basePipelineIndex must be -1. Libraries which are linked with link time optimization need VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT
+    Pipeline CreateGraphicsPipelineLibrary(VkGraphicsPipelineLibraryFlagsEXT parts, const GraphicsPipelineDescription &description,
+                                           const PipelineCache &pipelineCache = {}) const;
+    // links libraries which together contain all four parts into a complete pipeline, with VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT
+    // the pipeline is optimized as a whole, otherwise linking is fast
+    Pipeline LinkGraphicsPipelineLibraries(const Span2<Pipeline> &libraries, const PipelineLayout &layout, const PipelineCache &pipelineCache = {},
+                                           VkPipelineCreateFlags flags = 0) const;
 
     // the pipelineStageFlag is used for the pWaitDstStageMask parameters in the VkSubmitInfo struct
     Semaphore createSemaphore(VkPipelineStageFlags pipelineStageFlag = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VkSemaphoreCreateFlags flags = 0) const;
@@ -1737,8 +2802,186 @@ class Device
 
   private:
     Impl::DispatchableObject<VkDevice, vkDestroyDevice> device_;
+    // declared after device_, so it is destroyed first
+    std::shared_ptr<Impl::ObjectCaches> objectCaches_;
+    PipelineManifest *pipelineManifest_ = nullptr;
+    PushDescriptorFunctions pushDescriptorFunctions_;
 }; // class Device
 
+// The pipelines created during a session, e.g. a QA play through, together with the objects they refer to.
+// Shader modules are referenced by ShaderLibrary::Hash. At the next start Replay compiles all of them in parallel,
+// which fills the pipeline cache before the pipelines are needed. Objects created with a pNext chain, immutable samplers
+// and pipelines with pNext chains cannot be recorded, pipelines which depend on them are left out. Thread safe.
+class PipelineManifest
+{
+public:
+
+    using ShaderModuleLookup = std::function<std::shared_ptr<const ShaderModule>(uint64_t hash)>;
+
+    PipelineManifest() = default;
+    PipelineManifest(const PipelineManifest &other) = delete;
+    PipelineManifest& operator=(const PipelineManifest &other) = delete;
+
+    // called by the device the manifest is attached to for every object it creates. Objects with a pNext chain are not recorded,
+    // but a previous entry for their handle, which belonged to a destroyed object, is removed
+    void RecordShaderModule(const void *pNext, VkShaderModule shaderModule, const Span<uint32_t> &code);
+    void RecordDescriptorSetLayout(const void *pNext, VkDescriptorSetLayout setLayout, const Span<VkDescriptorSetLayoutBinding> &bindings,
+                                   const Span<VkDescriptorBindingFlags> &bindingFlags, VkDescriptorSetLayoutCreateFlags flags);
+    void RecordPipelineLayout(const void *pNext, VkPipelineLayout pipelineLayout, const Span2<DescriptorSetLayout> &setLayouts,
+                              const Span<VkPushConstantRange> &pushConstantRanges, VkPipelineLayoutCreateFlags flags);
+    void RecordRenderPass(const void *pNext, VkRenderPass renderPass, const Span<AttachmentDescription> &attachments, const Span<SubpassDescription> &subpasses,
+                          const Span<SubpassDependency> &dependencies, VkRenderPassCreateFlags flags);
+    // derivative relations are not recorded, every pipeline is replayed on its own
+    void RecordGraphicsPipeline(const RenderPass &renderPass, uint32_t subpass, const Span<Pipeline::ShaderStage> &stages, const PipelineLayout &layout,
+                                const GraphicsPipelineStateDescription &state, VkPipelineCreateFlags flags);
+    void RecordComputePipeline(const Pipeline::ShaderStage &stage, const PipelineLayout &layout, VkPipelineCreateFlags flags);
+
+    size_t GetPipelineCount() const;
+
+    std::vector<char> Serialize() const;
+
+    // recreates the objects of a serialized manifest and compiles its pipelines with the compiler, then merges the caches of the compiler.
+    // Pipelines whose shader modules are not found are skipped. Returns the number of pipelines which have been compiled,
+    // 0 if the manifest is invalid or has been written by another version
+    static size_t Replay(const Device &device, const std::vector<char> &manifest, const ShaderModuleLookup &lookup, PipelineCompiler &compiler);
+
+private:
+
+    // serialized entries, equal entries are stored once
+    struct Table
+    {
+        uint32_t Add(std::string &&entry);
+
+        std::vector<std::string> entries;
+        std::unordered_map<std::string, uint32_t> indices;
+    };
+
+    bool AppendStage(std::string &data, const Pipeline::ShaderStage &stage) const;
+
+    mutable std::mutex mutex_;
+    Table shaderModules_;
+    Table setLayouts_;
+    Table pipelineLayouts_;
+    Table renderPasses_;
+    Table pipelines_;
+    std::unordered_map<VkShaderModule, uint32_t> shaderModuleIndices_;
+    std::unordered_map<VkDescriptorSetLayout, uint32_t> setLayoutIndices_;
+    std::unordered_map<VkPipelineLayout, uint32_t> pipelineLayoutIndices_;
+    std::unordered_map<VkRenderPass, uint32_t> renderPassIndices_;
+}; // class PipelineManifest
+
+// Variants of one shader over specialization constant axes of the types Ts, e.g. feature toggles, instead of one module per variant.
+// A variant becomes a pipeline on first use through the PipelineStateCache and is recorded. The recorded variants can be
+// exported into a PipelineManifest and compiled up front on the next run with PipelineManifest::Replay. Thread safe.
+template <typename... Ts>
+class ShaderVariantManager
+{
+public:
+
+    using Variant = std::tuple<Ts...>;
+
+    // the module and the cache must outlive the manager
+    ShaderVariantManager(const ShaderModule &module, std::string entryPointName, VkShaderStageFlagBits stage,
+                         const std::array<uint32_t, sizeof...(Ts)> &constantIDs, PipelineStateCache &pipelineStateCache)
+        : module_(&module), entryPointName_(std::move(entryPointName)), stage_(stage), constantIDs_(constantIDs)
+        , pipelineStateCache_(&pipelineStateCache) {}
+
+    ShaderVariantManager(const ShaderVariantManager &other) = delete;
+    ShaderVariantManager& operator=(const ShaderVariantManager &other) = delete;
+
+    // the stage of the manager is added to the stages of the description or replaces the one of the same stage
+    const Pipeline& Get(const GraphicsPipelineDescription &description, const Ts&... values)
+    {
+        const Specialization<Ts...> specialization(constantIDs_, values...);
+        Record(Variant(values...));
+        return pipelineStateCache_->Get(MakeVariantDescription(description, specialization));
+    }
+
+    // the stage of the description is replaced
+    const Pipeline& Get(const ComputePipelineDescription &description, const Ts&... values)
+    {
+        const Specialization<Ts...> specialization(constantIDs_, values...);
+        Record(Variant(values...));
+        return pipelineStateCache_->Get(MakeVariantDescription(description, specialization));
+    }
+
+    // sorted
+    std::vector<Variant> GetUsedVariants() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return usedVariants_;
+    }
+
+    // records the pipelines of all used variants with the description, e.g. for another render pass. The module and the objects
+    // of the description must have been created while the manifest was attached to the device, see Device::SetPipelineManifest
+    void ExportManifest(PipelineManifest &manifest, const GraphicsPipelineDescription &description) const
+    {
+        for (const auto &variant : GetUsedVariants())
+        {
+            std::apply([&](const Ts&... values)
+            {
+                const Specialization<Ts...> specialization(constantIDs_, values...);
+                const auto variantDescription = MakeVariantDescription(description, specialization);
+                manifest.RecordGraphicsPipeline(*variantDescription.renderPass, variantDescription.subpass, variantDescription.stages,
+                                                *variantDescription.layout, variantDescription.state, variantDescription.flags);
+            }, variant);
+        }
+    }
+
+    void ExportManifest(PipelineManifest &manifest, const ComputePipelineDescription &description) const
+    {
+        for (const auto &variant : GetUsedVariants())
+        {
+            std::apply([&](const Ts&... values)
+            {
+                const Specialization<Ts...> specialization(constantIDs_, values...);
+                const auto variantDescription = MakeVariantDescription(description, specialization);
+                manifest.RecordComputePipeline(variantDescription.stage, *variantDescription.layout, variantDescription.flags);
+            }, variant);
+        }
+    }
+
+private:
+
+    GraphicsPipelineDescription MakeVariantDescription(const GraphicsPipelineDescription &description, const Specialization<Ts...> &specialization) const
+    {
+        auto variantDescription = description;
+        auto it = std::find_if(variantDescription.stages.begin(), variantDescription.stages.end(),
+                               [&](const Pipeline::ShaderStage &s) { return s.stage == stage_; });
+        if (it == variantDescription.stages.end())
+        {
+            it = variantDescription.stages.insert(it, Pipeline::ShaderStage());
+        }
+        *it = Pipeline::ShaderStage(*module_, entryPointName_, stage_, 0, &specialization.GetInfo());
+        return variantDescription;
+    }
+
+    ComputePipelineDescription MakeVariantDescription(const ComputePipelineDescription &description, const Specialization<Ts...> &specialization) const
+    {
+        auto variantDescription = description;
+        variantDescription.stage = Pipeline::ShaderStage(*module_, entryPointName_, stage_, 0, &specialization.GetInfo());
+        return variantDescription;
+    }
+
+    void Record(Variant &&variant)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = std::lower_bound(usedVariants_.begin(), usedVariants_.end(), variant);
+        if (it == usedVariants_.end() || *it != variant)
+        {
+            usedVariants_.insert(it, std::move(variant));
+        }
+    }
+
+    const ShaderModule *module_;
+    std::string entryPointName_;
+    VkShaderStageFlagBits stage_;
+    std::array<uint32_t, sizeof...(Ts)> constantIDs_;
+    PipelineStateCache *pipelineStateCache_;
+    mutable std::mutex mutex_;
+    std::vector<Variant> usedVariants_;
+}; // class ShaderVariantManager
+
 struct MappedMemoryRange
 {
     friend class DeviceMemory;
@@ -1862,6 +3105,89 @@ private:
     Impl::NonDispatchableObject<VkEvent, VkDevice, vkDestroyEvent> event_;
 }; // class Event
 
+// Thread safe pool of events
+class EventPool
+{
+public:
+
+    EventPool() = default;
+    explicit EventPool(const Device &device, uint32_t initialEventCount = 0);
+
+    // returns an event in the reset state
+    Event Acquire();
+    // the event must not be used by any pending command buffer anymore
+    void Release(Event &&event);
+
+private:
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    std::mutex mutex_;
+    std::vector<Event> free_;
+}; // class EventPool
+
+// Records a sequence of passes and turns the dependencies between them into split barriers: the producer signals an event
+// right after its commands and the consumer waits on it right before its commands, so the passes recorded in between
+// overlap with the dependency. Dependencies between adjacent passes use a regular pipeline barrier.
+// Passes must not be recorded inside a render pass instance. Events are taken from the EventPool and returned by ReleaseEvents
+// or on destruction, in both cases the recorded command buffers must have completed execution.
+class BarrierScheduler
+{
+public:
+
+    using RecordFunction = std::function<void(const CommandBuffer&)>;
+
+    BarrierScheduler() = default;
+    explicit BarrierScheduler(EventPool &eventPool)
+        : eventPool_(&eventPool) {}
+    ~BarrierScheduler();
+    BarrierScheduler(const BarrierScheduler &other) = delete;
+    BarrierScheduler& operator=(const BarrierScheduler &other) = delete;
+
+    // returns the index of the pass, passes are recorded in the order they have been added
+    uint32_t AddPass(RecordFunction record);
+    // the producer must have been added before the consumer
+    void AddDependency(uint32_t producer, uint32_t consumer, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
+                       const Span<MemoryBarrier> &memoryBarriers = {}, const Span<VkBufferMemoryBarrier> &bufferMemoryBarriers = {},
+                       const Span<VkImageMemoryBarrier> &imageMemoryBarriers = {});
+
+    // records all passes with their barriers, the passes and dependencies are cleared afterwards
+    void Record(const CommandBuffer &commandBuffer);
+    // returns the events of all previous recordings to the pool, the command buffers must have completed execution
+    void ReleaseEvents();
+
+private:
+
+    struct Dependency
+    {
+        uint32_t producer;
+        uint32_t consumer;
+        VkPipelineStageFlags srcStageMask;
+        VkPipelineStageFlags dstStageMask;
+        // ranges in the barrier arrays below
+        uint32_t memoryBarrierOffset;
+        uint32_t memoryBarrierCount;
+        uint32_t bufferMemoryBarrierOffset;
+        uint32_t bufferMemoryBarrierCount;
+        uint32_t imageMemoryBarrierOffset;
+        uint32_t imageMemoryBarrierCount;
+    };
+
+    void AppendBarriers(const Dependency &dependency);
+
+    EventPool *eventPool_ = nullptr;
+    std::vector<RecordFunction> passes_;
+    std::vector<Dependency> dependencies_;
+    std::vector<MemoryBarrier> memoryBarriers_;
+    std::vector<VkBufferMemoryBarrier> bufferMemoryBarriers_;
+    std::vector<VkImageMemoryBarrier> imageMemoryBarriers_;
+    std::vector<Event> events_;
+
+    // scratch space of Record
+    std::vector<MemoryBarrier> pendingMemoryBarriers_;
+    std::vector<VkBufferMemoryBarrier> pendingBufferMemoryBarriers_;
+    std::vector<VkImageMemoryBarrier> pendingImageMemoryBarriers_;
+}; // class BarrierScheduler
+
 class Fence
 {
 public:
@@ -1890,6 +3216,7 @@ public:
     }
 
     VkResult Wait(uint64_t timeoutInNanoSeconds = UINT64_MAX) const;
+    VkResult Wait(const WaitStrategy &strategy, uint64_t timeoutInNanoSeconds = UINT64_MAX) const;
     void Reset() const;
     VkResult GetStatus() const;
 
@@ -1898,6 +3225,254 @@ private:
     Impl::NonDispatchableObject<VkFence, VkDevice, vkDestroyFence> fence_;
 }; // class Fence
 
+// Thread safe pool of fences. Submitted fences are recycled once they have been signaled,
+// all of them are reset with a single Device::ResetFences call.
+class FencePool
+{
+public:
+
+    FencePool() = default;
+    explicit FencePool(const Device &device, uint32_t initialFenceCount = 0);
+
+    // returns an unsignaled fence
+    Fence Acquire();
+    // pending: the fence has been submitted and will be recycled once it has been signaled
+    // otherwise the fence must be unsignaled
+    void Release(Fence &&fence, bool pending);
+    // makes all pending fences which have been signaled available again
+    void Recycle();
+
+private:
+
+    void RecycleLocked();
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    std::mutex mutex_;
+    std::vector<Fence> free_;
+    std::vector<Fence> pending_;
+    std::vector<Fence> signaled_;
+}; // class FencePool
+
+// A single thread waits on all watched fences at once and invokes the callback of a fence once it has been signaled.
+// Callbacks are invoked on the watcher thread or handed to the executor, they must not throw.
+// Callbacks of fences which are still pending on destruction are discarded.
+class FenceWatcher
+{
+public:
+
+    using Callback = std::function<void()>;
+    using Executor = std::function<void(Callback&&)>;
+
+    // fences watched while the thread is blocked are picked up after at most pollIntervalInNanoSeconds
+    explicit FenceWatcher(const Device &device, Executor executor = {}, uint64_t pollIntervalInNanoSeconds = 1000000);
+    ~FenceWatcher();
+    FenceWatcher(const FenceWatcher &other) = delete;
+    FenceWatcher& operator=(const FenceWatcher &other) = delete;
+
+    // the fence must not be destroyed or reset before the callback has been invoked
+    void Watch(const Fence &fence, Callback callback);
+
+    // VK_SUCCESS or the error which made the watcher give up, e.g. VK_ERROR_DEVICE_LOST,
+    // after an error all callbacks are invoked immediately
+    VkResult GetResult() const
+    {
+        return result_.load();
+    }
+
+#ifdef VKW_COROUTINES
+    class Awaiter
+    {
+    public:
+
+        Awaiter(FenceWatcher &watcher, VkFence fence)
+            : watcher_(&watcher), fence_(fence) {}
+
+        bool await_ready() const
+        {
+            return vkGetFenceStatus(watcher_->device_, fence_) == VK_SUCCESS;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) const
+        {
+            watcher_->Watch(fence_, [handle]() { handle.resume(); });
+        }
+
+        // VK_SUCCESS or the error which made the watcher give up
+        VkResult await_resume() const
+        {
+            return watcher_->GetResult();
+        }
+
+    private:
+
+        FenceWatcher *watcher_;
+        VkFence fence_;
+    };
+
+    // co_await watcher.Wait(fence) suspends the coroutine until the fence has been signaled,
+    // it is resumed on the executor
+    Awaiter Wait(const Fence &fence)
+    {
+        return Awaiter(*this, VkFence(fence));
+    }
+#endif
+
+private:
+
+    void Watch(VkFence fence, Callback &&callback);
+    void Run();
+
+    VkDevice device_;
+    Executor executor_;
+    const uint64_t pollIntervalInNanoSeconds_;
+    std::atomic<VkResult> result_ = {VK_SUCCESS};
+
+    bool stop_ = false;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<VkFence> incomingFences_;
+    std::vector<Callback> incomingCallbacks_;
+    std::thread thread_;
+}; // class FenceWatcher
+
+// Completion state of a submission, callbacks added after completion are invoked immediately on the calling thread.
+class CompletionHandle
+{
+public:
+
+    using Callback = FenceWatcher::Callback;
+
+    CompletionHandle() = default;
+
+    explicit operator bool() const
+    {
+        return state_ != nullptr;
+    }
+
+    bool operator== (const CompletionHandle &other) const
+    {
+        return state_ == other.state_;
+    }
+
+    bool operator!= (const CompletionHandle &other) const
+    {
+        return state_ != other.state_;
+    }
+
+    bool IsComplete() const;
+    // callbacks are invoked in the order they have been added
+    const CompletionHandle& Then(Callback callback) const;
+    // returns VK_SUCCESS or the error reported by the FenceWatcher, e.g. VK_ERROR_DEVICE_LOST
+    VkResult Wait() const;
+
+private:
+
+    friend class CompletionService;
+
+    struct State
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool complete = false;
+        VkResult result = VK_SUCCESS;
+        std::vector<Callback> callbacks;
+        Fence fence;
+    };
+
+    explicit CompletionHandle(std::shared_ptr<State> state)
+        : state_(std::move(state)) {}
+
+    std::shared_ptr<State> state_;
+}; // class CompletionHandle
+
+// Hands out completion handles for submissions. Fences come from a FencePool and are returned to it
+// once the FenceWatcher has seen them signaled and the callbacks of the handle have run.
+// All tracked submissions must have completed before the service is destroyed.
+class CompletionService
+{
+public:
+
+    explicit CompletionService(const Device &device, FenceWatcher::Executor executor = {}, uint32_t initialFenceCount = 0);
+
+    // the fence must be passed to a single queue submission and then to Track
+    Fence AcquireFence();
+    CompletionHandle Track(Fence &&fence);
+
+private:
+
+    static void Complete(FencePool &fencePool, CompletionHandle::State &state, VkResult result);
+
+    // shared with the callbacks on the executor, which may still run after the service is gone
+    std::shared_ptr<FencePool> fencePool_;
+    FenceWatcher::Executor executor_;
+    FenceWatcher watcher_;
+}; // class CompletionService
+
+// Owns the per frame resources of frameCount frames in flight. BeginFrame waits only on the fence of the
+// oldest frame, which is the one whose resources are about to be reused.
+// The last submission of a frame must signal the fence returned by GetSubmitFence. A frame which is dropped
+// before that submission, e.g. because acquiring the swapchain image failed, leaves its fence signaled.
+class FrameContext
+{
+public:
+
+    struct Frame
+    {
+        // signaled unless the submission of the frame is pending, use GetSubmitFence for the submission
+        Fence fence;
+        CommandPool commandPool;
+        // primary command buffer allocated once from commandPool, reset together with the pool
+        CommandBuffer commandBuffer;
+        DescriptorPool descriptorPool;
+        // slice [ringOffset, ringOffset + ringSize) of the ring buffer owned by the caller
+        VkDeviceSize ringOffset = 0;
+        VkDeviceSize ringSize = 0;
+        VkDeviceSize ringHead = 0;
+        // objects which are released once the frame's fence has been signaled
+        std::vector<std::shared_ptr<void>> deferredDeletions;
+    };
+
+    FrameContext() = default;
+    // descriptor pools are only created if maxDescriptorSets > 0
+    FrameContext(const Device &device, uint32_t frameCount, uint32_t queueFamilyIndex, VkDeviceSize ringSliceSize = 0,
+                 uint32_t maxDescriptorSets = 0, const Span<VkDescriptorPoolSize> &descriptorPoolSizes = {},
+                 VkCommandPoolCreateFlags commandPoolFlags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+    explicit operator bool() const
+    {
+        return !frames_.empty();
+    }
+
+    // throws an Exception with VK_TIMEOUT if the oldest frame has not completed in time, the current frame stays the same then
+    Frame& BeginFrame(uint64_t timeoutInNanoSeconds = UINT64_MAX);
+    // resets the fence of the current frame on the first call after BeginFrame, call it right before the submission which signals it
+    const Fence& GetSubmitFence();
+    // waits for all frames in flight and releases all deferred objects
+    void WaitIdle();
+
+    Frame& GetCurrentFrame();
+    const Frame& GetCurrentFrame() const;
+    uint32_t GetFrameIndex() const;
+    uint64_t GetFrameNumber() const;
+    uint32_t GetFrameCount() const;
+
+    // returns an offset into the ring buffer, or nothing if the slice of the current frame is exhausted
+    std::optional<VkDeviceSize> Allocate(VkDeviceSize size, VkDeviceSize alignment = 1);
+
+    template <typename T>
+    void DeferDestruction(T &&object)
+    {
+        GetCurrentFrame().deferredDeletions.emplace_back(std::make_shared<std::decay_t<T>>(std::forward<T>(object)));
+    }
+
+private:
+
+    std::vector<Frame> frames_;
+    uint32_t frameIndex_ = 0;
+    uint64_t frameNumber_ = 0;
+    bool fenceReset_ = false;
+}; // class FrameContext
+
 class Framebuffer
 {
 public:
@@ -2235,6 +3810,46 @@ private:
     Impl::NonDispatchableObject<VkPipelineLayout, VkDevice, vkDestroyPipelineLayout> layout_;
 }; // class PipelineLayout
 
+// Prebuilt VkPresentInfoKHR for presentations which are repeated every frame,
+// only the image indices change between two presentations.
+class PresentBatch
+{
+public:
+
+    PresentBatch() = default;
+    explicit PresentBatch(const Span2<Swapchain> &swapchains, const Span2<Semaphore> &waitSemaphores = {});
+    PresentBatch(const void *pNext, const Span2<Swapchain> &swapchains, const Span2<Semaphore> &waitSemaphores = {});
+    PresentBatch(const PresentBatch &other) = delete;
+    PresentBatch(PresentBatch &&other) noexcept = default;
+    PresentBatch& operator=(const PresentBatch &other) = delete;
+    PresentBatch& operator=(PresentBatch &&other) noexcept = default;
+
+    explicit operator VkPresentInfoKHR() const
+    {
+        return presentInfo_;
+    }
+
+    void SetImageIndex(uint32_t imageIndex, uint32_t swapchainIndex = 0)
+    {
+        assert(swapchainIndex < imageIndices_.size());
+        imageIndices_[swapchainIndex] = imageIndex;
+    }
+
+    // results of the last presentation, one per swapchain
+    Span<VkResult> GetResults() const
+    {
+        return Span<VkResult>(results_.data(), results_.size());
+    }
+
+private:
+
+    std::vector<VkSemaphore> waitSemaphores_;
+    std::vector<VkSwapchainKHR> swapchains_;
+    std::vector<uint32_t> imageIndices_;
+    std::vector<VkResult> results_;
+    VkPresentInfoKHR presentInfo_ = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
+}; // class PresentBatch
+
 class QueryPool
 {
 public:
@@ -2315,6 +3930,15 @@ public:
     std::vector<VkResult> Present(const Span2<Swapchain> &swapchains, const Span<uint32_t> &imageIndices, const Span2<Semaphore> &waitSemaphores = {}) const;
     std::vector<VkResult> PresentExt(const void *pNext, const Span2<Swapchain> &swapchains, const Span<uint32_t> &imageIndices, const Span2<Semaphore> &waitSemaphores = {}) const;
 
+    // prebuilt batches are submitted and presented without any conversions or allocations
+    void Submit(const Span2<SubmitBatch> &batches, const Fence &signalFence = {}) const;
+    VkResult Present(const PresentBatch &batch) const;
+
+    // the returned handle completes once the submitted work has finished executing
+    CompletionHandle Submit(CompletionService &service, const Span<CommandBuffer> &commandBuffers, const Span2<Semaphore> &waitSemaphores = {},
+                            const Span2<Semaphore> &signalSemaphores = {}) const;
+    CompletionHandle Submit(CompletionService &service, const Span2<SubmitBatch> &batches) const;
+
 private:
     VkQueue queue_ = VK_NULL_HANDLE;
 }; // class Queue
@@ -2423,6 +4047,145 @@ private:
     VkPipelineStageFlags pipelineStageFlag_ = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
 }; // class Semaphore
 
+// Multi producer submission front end of a Queue. Any thread can push command buffers into a lock free ring,
+// a dedicated submit thread drains it and merges adjacent entries into a single vkQueueSubmit call.
+// An entry with a fence ends a merged submission.
+// Tokens only track the hand over to vkQueueSubmit, not the execution on the GPU; use fences or semaphores for that.
+class SubmissionQueue
+{
+public:
+
+    using Token = uint64_t;
+
+    // capacity has to be a power of two
+    explicit SubmissionQueue(const Queue &queue, uint32_t capacity = 256);
+    ~SubmissionQueue();
+    SubmissionQueue(const SubmissionQueue &other) = delete;
+    SubmissionQueue& operator=(const SubmissionQueue &other) = delete;
+
+    // blocks while the ring is full
+    Token Push(const Span<CommandBuffer> &commandBuffers, const Span2<Semaphore> &waitSemaphores = {},
+               const Span2<Semaphore> &signalSemaphores = {}, const Fence &signalFence = {});
+
+    // true once the entry has been handed to vkQueueSubmit, the GPU may still be executing it
+    bool IsSubmitted(Token token) const;
+    // Blocks until the entry has been handed to vkQueueSubmit, throws if the vkQueueSubmit call which contained it failed.
+    // A failure is reported once, to the first Wait for one of its entries, failures of entries before token are dropped.
+    void Wait(Token token);
+
+private:
+
+    // tokens [begin, end) were part of a vkQueueSubmit call which returned result
+    struct Failure
+    {
+        Token begin;
+        Token end;
+        VkResult result;
+    };
+
+    struct Entry
+    {
+        std::vector<VkCommandBuffer> commandBuffers;
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<VkPipelineStageFlags> waitDstStageMask;
+        std::vector<VkSemaphore> signalSemaphores;
+        VkFence signalFence = VK_NULL_HANDLE;
+    };
+
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        Entry entry;
+    };
+
+    void WaitSubmitted(Token token);
+    void Run();
+    uint32_t GetReadyCount() const;
+    void Process(uint32_t count);
+
+    Queue queue_;
+    const uint64_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> enqueuePos_ = {0};
+    uint64_t dequeuePos_ = 0;
+    std::atomic<uint64_t> submitted_ = {0};
+    std::vector<VkSubmitInfo> submitInfos_;
+
+    std::atomic<bool> stop_ = {false};
+    std::atomic<bool> sleeping_ = {false};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic<uint32_t> waiters_ = {0};
+    std::mutex completionMutex_;
+    std::condition_variable completionCv_;
+    // guarded by completionMutex_, ordered by their tokens
+    std::deque<Failure> failures_;
+    std::atomic<bool> failed_ = {false};
+    std::thread thread_;
+}; // class SubmissionQueue
+
+// Prebuilt VkSubmitInfo for submissions which are repeated every frame,
+// only the command buffers change between two submissions.
+class SubmitBatch
+{
+public:
+
+    SubmitBatch() = default;
+    explicit SubmitBatch(uint32_t commandBufferCount, const Span2<Semaphore> &waitSemaphores = {}, const Span2<Semaphore> &signalSemaphores = {});
+    SubmitBatch(const void *pNext, uint32_t commandBufferCount, const Span2<Semaphore> &waitSemaphores = {}, const Span2<Semaphore> &signalSemaphores = {});
+    SubmitBatch(const SubmitBatch &other) = delete;
+    SubmitBatch(SubmitBatch &&other) noexcept = default;
+    SubmitBatch& operator=(const SubmitBatch &other) = delete;
+    SubmitBatch& operator=(SubmitBatch &&other) noexcept = default;
+
+    explicit operator VkSubmitInfo() const
+    {
+        return submitInfo_;
+    }
+
+    void SetCommandBuffer(const CommandBuffer &commandBuffer, uint32_t index = 0)
+    {
+        assert(index < commandBuffers_.size());
+        commandBuffers_[index] = VkCommandBuffer(commandBuffer);
+    }
+
+    // at most the commandBufferCount passed at construction
+    void SetCommandBuffers(const Span<CommandBuffer> &commandBuffers)
+    {
+        assert(commandBuffers.Count() <= commandBuffers_.size());
+        commandBuffers.Emplace(commandBuffers_.data());
+        submitInfo_.commandBufferCount = commandBuffers.Count();
+    }
+
+private:
+
+    std::vector<VkSemaphore> waitSemaphores_;
+    std::vector<VkPipelineStageFlags> waitDstStageMask_;
+    std::vector<VkCommandBuffer> commandBuffers_;
+    std::vector<VkSemaphore> signalSemaphores_;
+    VkSubmitInfo submitInfo_ = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+}; // class SubmitBatch
+
+// Thread safe pool of binary semaphores
+class SemaphorePool
+{
+public:
+
+    SemaphorePool() = default;
+    explicit SemaphorePool(const Device &device, uint32_t initialSemaphoreCount = 0);
+
+    // the pipelineStageFlag is used for the pWaitDstStageMask parameters in the VkSubmitInfo struct
+    Semaphore Acquire(VkPipelineStageFlags pipelineStageFlag = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+    // the semaphore must be unsignaled and the submission waiting on it must have completed
+    void Release(Semaphore &&semaphore);
+
+private:
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    std::mutex mutex_;
+    std::vector<Semaphore> free_;
+}; // class SemaphorePool
+
 class Surface
 {
 public:
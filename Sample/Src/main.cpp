@@ -3,7 +3,6 @@
 #include <algorithm>
 #include <array>
 #include <chrono>
-#include <fstream>
 #include <iostream>
 #include <iterator>
 #include <limits>
@@ -60,6 +59,8 @@ public:
         VkDeviceSize offset;
     };
 
+    static constexpr uint32_t framesInFlight = 2;
+
     VulkanTutorial() = default;
 
     void Init(const VkExtent2D &extent, HINSTANCE hInstance, HWND hWnd);
@@ -82,6 +83,7 @@ private:
     vkw::Device device_;
 
     vkw::Queue gfxQueue_;
+    uint32_t gfxQueueIdx_ = 0;
 
     vkw::Swapchain swapchain_;
     uint32_t swapchainImageCount_ = 0;
@@ -111,16 +113,19 @@ private:
 
     vkw::Buffer uniformBuffer_;
     vkw::DescriptorBufferInfo uniformBufferDesc_;
+    VkDeviceSize uniformBufferAlignment_ = 1;
+    uint32_t uniformBufferOffset_ = 0;
     vkw::DeviceMemory stgMemory_;
 
     vkw::DescriptorPool descPool_;
     vkw::DescriptorSet descSet_;
 
-    std::vector<vkw::CommandBuffer> cmdBuffers_;
+    vkw::FrameContext frameContext_;
 
     std::vector<vkw::Semaphore> imageAvailableSemaphore_;
     std::vector<vkw::Semaphore> renderFinishedSemaphore_;
-    uint32_t frameIdx = 0;
+    std::vector<vkw::SubmitBatch> submitBatches_;
+    std::vector<vkw::PresentBatch> presentBatches_;
 };
 
 std::tuple<vkw::PhysicalDevice, uint32_t, VkSurfaceCapabilitiesKHR,
@@ -225,23 +230,6 @@ VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities, const
     return actualExtent;
 }
 
-static std::vector<char> readFile(const std::string& filename)
-{
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open())
-    {
-        throw std::runtime_error("failed to open file!");
-    }
-
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
-    return buffer;
-}
-
 std::tuple<std::vector<VulkanTutorial::Vertex>, std::vector<uint32_t>> loadObj(const std::string &fileName)
 {
     tinyobj::attrib_t attrib;
@@ -410,6 +398,7 @@ void VulkanTutorial::Init(const VkExtent2D &extent, HINSTANCE hInstance, HWND hW
         swapchainImageViews_.emplace_back(i.CreateImageView(VK_IMAGE_VIEW_TYPE_2D, surfaceFormat_.format, VK_IMAGE_ASPECT_COLOR_BIT));
     }
 
+    gfxQueueIdx_ = gfxQueueIdx;
     gfxQueue_ = device_.GetQueue(gfxQueueIdx);
     cmdPool_ = device_.CreateCommandPool(gfxQueueIdx);
 }
@@ -489,8 +478,11 @@ void VulkanTutorial::CreateResources()
 
 void VulkanTutorial::CreateGfxPipeline()
 {
+    // every frame in flight writes its own slice of the uniform buffer
+    uniformBufferAlignment_ = physDevice_.GetProperties().limits.minUniformBufferOffsetAlignment;
     uniformBufferDesc_.range = sizeof(UniformBufferObject);
-    uniformBuffer_ = device_.CreateBuffer(uniformBufferDesc_.range, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+    VkDeviceSize uniformBufferSliceSize = (uniformBufferDesc_.range + uniformBufferAlignment_ - 1) / uniformBufferAlignment_ * uniformBufferAlignment_;
+    uniformBuffer_ = device_.CreateBuffer(uniformBufferSliceSize * framesInFlight, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
     uniformBufferDesc_.buffer = &uniformBuffer_;
     auto uniformBufferMemReq = uniformBuffer_.GetMemoryRequirements();
     stgMemory_ = device_.AllocateMemory(uniformBufferMemReq.size, findMemoryType(memProps_, uniformBufferMemReq.memoryTypeBits,
@@ -504,11 +496,16 @@ void VulkanTutorial::CreateGfxPipeline()
     samplerDesc.maxAnisotropy = 16.0f;
     sampler_ = device_.CreateSampler(samplerDesc);
 
-    auto vertexShader = device_.CreateShaderModule(readFile("../Src/Shaders/vert.spv"));
-    auto fragmentShader = device_.CreateShaderModule(readFile("../Src/Shaders/frag.spv"));
+    vkw::ShaderLibrary shaderLibrary(device_);
+    auto vertexShader = shaderLibrary.Load("../Src/Shaders/vert.spv");
+    auto fragmentShader = shaderLibrary.Load("../Src/Shaders/frag.spv");
+    if (!vertexShader || !fragmentShader)
+    {
+        throw std::runtime_error("failed to open file!");
+    }
 
-    vkw::Pipeline::ShaderStage vertexShaderStage(vertexShader, "main", VK_SHADER_STAGE_VERTEX_BIT);
-    vkw::Pipeline::ShaderStage fragmentShaderStage(fragmentShader, "main", VK_SHADER_STAGE_FRAGMENT_BIT);
+    vkw::Pipeline::ShaderStage vertexShaderStage(*vertexShader, "main", VK_SHADER_STAGE_VERTEX_BIT);
+    vkw::Pipeline::ShaderStage fragmentShaderStage(*fragmentShader, "main", VK_SHADER_STAGE_FRAGMENT_BIT);
 
     vkw::GraphicsPipelineStateDescription gfxPipelineDesc;
     gfxPipelineDesc.vertexInputState = vkw::Pipeline::VertexInputState(Vertex::getBindingDescription(), Vertex::getAttributeDescriptions());
@@ -525,13 +522,15 @@ void VulkanTutorial::CreateGfxPipeline()
     colorBlendState.attachments[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
     gfxPipelineDesc.colorBlendState = &colorBlendState;
 
-    descPool_ = device_.CreateDescriptorPool(1, {{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1}, {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1}});
-    descSetLayout_ = device_.CreateDescriptorSetLayout({{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT},
+    descPool_ = device_.CreateDescriptorPool(1, {{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1}, {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1}});
+    descSetLayout_ = device_.CreateDescriptorSetLayout({{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT},
                                                         {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT}});
     descSet_ = descPool_.AllocateDescriptorSet(descSetLayout_);
 
-    device_.UpdateDescriptorSet(descSet_, 0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniformBufferDesc_);
-    device_.UpdateDescriptorSet(descSet_, 1, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, vkw::DescriptorImageInfo(sampler_, texImageView_, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+    vkw::DescriptorWriter(device_)
+        .Write(descSet_, 0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, uniformBufferDesc_)
+        .Write(descSet_, 1, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, vkw::DescriptorImageInfo(sampler_, texImageView_, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL))
+        .Flush();
 
     pipelineLayout_ = device_.CreatePipelineLayout(descSetLayout_);
     renderPass_ = device_.CreateRenderPass({vkw::AttachmentDescription(surfaceFormat_.format, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_UNDEFINED,
@@ -553,30 +552,24 @@ void VulkanTutorial::CreateGfxPipeline()
 
 void VulkanTutorial::CreateCommandBuffers()
 {
-    cmdBuffers_ = cmdPool_.AllocateCommandBuffers(static_cast<uint32_t>(framebuffers_.size()));
-    size_t cmdBufferIndex = 0;
-    for (const auto &cb : cmdBuffers_)
-    {
-        cb.Begin(VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT);
-        cb.BeginRenderPass(renderPass_, framebuffers_[cmdBufferIndex], extent_, {VkClearValue{{0.0f, 0.0f, 0.0f, 0.0f}}, VkClearValue{{1.0f, 0}}});
-        cb.BindGraphicsPipeline(gfxPipeline_);
-        cb.BindVertexBuffers(objBuffer_, 0);
-        cb.BindIndexBuffer(objBuffer_, indexBufferOffset_, VK_INDEX_TYPE_UINT32);
-        cb.BindGraphicsDescriptorSets(pipelineLayout_, descSet_);
-        cb.DrawIndexed(indexCount_);
-        cb.EndRenderPass();
-        cb.End();
-        ++cmdBufferIndex;
-    }
+    // every frame slot owns one command buffer which is re-recorded after its pool was reset
+    auto uniformBufferSliceSize = (uniformBufferDesc_.range + uniformBufferAlignment_ - 1) / uniformBufferAlignment_ * uniformBufferAlignment_;
+    frameContext_ = vkw::FrameContext(device_, framesInFlight, gfxQueueIdx_, uniformBufferSliceSize);
 }
 
 void VulkanTutorial::CreateSemaphores()
 {
-    for (const auto &f : framebuffers_)
+    for (uint32_t i = 0; i < framesInFlight; ++i)
     {
         imageAvailableSemaphore_.emplace_back(device_.createSemaphore(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT));
         renderFinishedSemaphore_.emplace_back(device_.createSemaphore());
     }
+
+    for (uint32_t i = 0; i < framesInFlight; ++i)
+    {
+        submitBatches_.emplace_back(1, imageAvailableSemaphore_[i], renderFinishedSemaphore_[i]);
+        presentBatches_.emplace_back(swapchain_, renderFinishedSemaphore_[i]);
+    }
 }
 
 void VulkanTutorial::Update()
@@ -591,20 +584,40 @@ void VulkanTutorial::Update()
     ubo.proj = glm::perspective(glm::radians(45.0f), static_cast<float>(extent_.width) / extent_.height, 0.1f, 10.0f);
     ubo.proj[1][1] *= -1;
 
+    // waits until the frame which used this slice of the uniform buffer before has completed
+    frameContext_.BeginFrame();
+    auto offset = frameContext_.Allocate(sizeof(ubo), uniformBufferAlignment_);
+    if (!offset) { throw std::runtime_error("uniform buffer slice exhausted!"); }
+    uniformBufferOffset_ = static_cast<uint32_t>(*offset);
+
     // use push constants instead!
-    void *data = stgMemory_.Map();
+    void *data = stgMemory_.Map(uniformBufferOffset_, sizeof(ubo));
     memcpy(data, &ubo, sizeof(ubo));
     stgMemory_.Unmap();
 }
 
 void VulkanTutorial::Draw()
 {
-    auto semaphoreId = frameIdx % swapchainImageCount_;
+    const auto &frame = frameContext_.GetCurrentFrame();
+    auto semaphoreId = frameContext_.GetFrameIndex();
     auto[imageIndex, res] = swapchain_.AcquireNextImage(imageAvailableSemaphore_[semaphoreId]);
 
-    gfxQueue_.Submit(cmdBuffers_[imageIndex], imageAvailableSemaphore_[semaphoreId], renderFinishedSemaphore_[semaphoreId]);
-
-    res = gfxQueue_.Present(swapchain_, imageIndex, renderFinishedSemaphore_[semaphoreId]);
-
-    ++frameIdx;
+    const auto &cb = frame.commandBuffer;
+    cb.Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    cb.BeginRenderPass(renderPass_, framebuffers_[imageIndex], extent_, {VkClearValue{{0.0f, 0.0f, 0.0f, 0.0f}}, VkClearValue{{1.0f, 0}}});
+    cb.BindGraphicsPipeline(gfxPipeline_);
+    cb.BindVertexBuffers(objBuffer_, 0);
+    cb.BindIndexBuffer(objBuffer_, indexBufferOffset_, VK_INDEX_TYPE_UINT32);
+    cb.BindGraphicsDescriptorSets(pipelineLayout_, descSet_, 0, uniformBufferOffset_);
+    cb.DrawIndexed(indexCount_);
+    cb.EndRenderPass();
+    cb.End();
+
+    auto &submitBatch = submitBatches_[semaphoreId];
+    submitBatch.SetCommandBuffer(cb);
+    gfxQueue_.Submit(submitBatch, frameContext_.GetSubmitFence());
+
+    auto &presentBatch = presentBatches_[semaphoreId];
+    presentBatch.SetImageIndex(imageIndex);
+    res = gfxQueue_.Present(presentBatch);
 }
\ No newline at end of file
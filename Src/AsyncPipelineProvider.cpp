@@ -0,0 +1,271 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include <chrono>
+#include <deque>
+
+#include "Error.h"
+
+namespace vkw
+{
+
+namespace
+{
+
+const PipelineCache& GetPipelineCache(const PipelineCache *pPipelineCache)
+{
+    static const PipelineCache noPipelineCache;
+    return pPipelineCache != nullptr ? *pPipelineCache : noPipelineCache;
+}
+
+// a description with copies of the state it points to, the compiler reads it after Get has returned
+template <typename T>
+struct OwnedDescription
+{
+    explicit OwnedDescription(const T &description)
+        : description(description) {}
+
+    T description;
+    std::unique_ptr<Pipeline::TessellationState> tessellationState;
+    std::unique_ptr<Pipeline::ViewportState> viewportState;
+    std::unique_ptr<Pipeline::MultisampleState> multisampleState;
+    std::vector<VkSampleMask> sampleMask;
+    std::unique_ptr<Pipeline::DepthStencilState> depthStencilState;
+    std::unique_ptr<Pipeline::ColorBlendState> colorBlendState;
+    std::unique_ptr<Pipeline::DynamicState> dynamicState;
+    std::deque<std::vector<uint8_t>> specializationData;
+    std::deque<SpecializationInfo> specializations;
+};
+
+template <typename S>
+S* CopyState(std::unique_ptr<S> &owned, const S *state)
+{
+    if (state == nullptr)
+    {
+        return nullptr;
+    }
+    owned = std::make_unique<S>(*state);
+    return owned.get();
+}
+
+template <typename T>
+void CopySpecialization(OwnedDescription<T> &owned, Pipeline::ShaderStage &stage)
+{
+    if (stage.pSpecializationInfo == nullptr)
+    {
+        return;
+    }
+
+    const auto &specialization = *stage.pSpecializationInfo;
+    const auto pData = static_cast<const uint8_t*>(specialization.pData);
+    owned.specializationData.emplace_back(pData, pData + specialization.dataSize);
+    const auto &data = owned.specializationData.back();
+    owned.specializations.emplace_back(data.data(), data.size(),
+                                       Span<VkSpecializationMapEntry>(specialization.pMapEntries, specialization.mapEntryCount));
+    stage.pSpecializationInfo = &owned.specializations.back();
+}
+
+} // namespace
+
+AsyncPipelineProvider::AsyncPipelineProvider(const Device &device, PipelineCompiler &compiler, const PipelineCache &pipelineCache, bool probeCache)
+    : device_(std::make_shared<const Device>(device.GetView()))
+    , compiler_(&compiler)
+    , pipelineCache_(pipelineCache ? &pipelineCache : nullptr)
+    , probeCache_(probeCache)
+{
+    assert(device);
+}
+
+const Pipeline& AsyncPipelineProvider::Get(const GraphicsPipelineDescription &description, const Pipeline &fallback)
+{
+    return Get<GraphicsPipelineDescription>(description, fallback);
+}
+
+const Pipeline& AsyncPipelineProvider::Get(const ComputePipelineDescription &description, const Pipeline &fallback)
+{
+    return Get<ComputePipelineDescription>(description, fallback);
+}
+
+template <typename T>
+const Pipeline& AsyncPipelineProvider::Get(const T &description, const Pipeline &fallback)
+{
+    assert(description.basePipelineIndex < 0);
+
+    PipelineKey key(description);
+
+    Entry *entry = nullptr;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        const auto it = entries_.find(key);
+        if (it != entries_.end())
+        {
+            entry = it->second.get();
+            // fast path, no exclusive lock once the pipeline is ready
+            if (entry->ready.load(std::memory_order_acquire))
+            {
+                return entry->pipeline;
+            }
+        }
+    }
+
+    if (entry == nullptr)
+    {
+        // probing and compiling happen outside of the lock, the entry is only inserted once they succeeded
+        auto newEntry = std::make_unique<Entry>();
+        if (probeCache_)
+        {
+            newEntry->pipeline = Probe(description);
+        }
+        if (newEntry->pipeline)
+        {
+            newEntry->ready.store(true, std::memory_order_relaxed);
+        }
+        else
+        {
+            newEntry->future = Compile(description);
+            ++pendingCount_;
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto &slot = entries_[std::move(key)];
+        if (!slot)
+        {
+            slot = std::move(newEntry);
+        }
+        else if (newEntry->future.valid())
+        {
+            // another thread inserted the entry first, its compile is used and this one is dropped
+            --pendingCount_;
+        }
+        entry = slot.get();
+    }
+
+    if (!entry->ready.load(std::memory_order_acquire))
+    {
+        if (entry->failed.load(std::memory_order_relaxed))
+        {
+            return fallback;
+        }
+
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        if (entry->future.valid() && entry->future.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            --pendingCount_;
+            try
+            {
+                entry->pipeline = entry->future.get();
+                entry->ready.store(true, std::memory_order_release);
+            }
+            catch (...)
+            {
+                // not thrown here, the fallback keeps being used and GetError reports the error
+                entry->error = std::current_exception();
+                entry->failed.store(true, std::memory_order_release);
+            }
+        }
+    }
+
+    return entry->ready.load(std::memory_order_acquire) ? entry->pipeline : fallback;
+}
+
+std::exception_ptr AsyncPipelineProvider::GetError(const GraphicsPipelineDescription &description) const
+{
+    return GetError<GraphicsPipelineDescription>(description);
+}
+
+std::exception_ptr AsyncPipelineProvider::GetError(const ComputePipelineDescription &description) const
+{
+    return GetError<ComputePipelineDescription>(description);
+}
+
+template <typename T>
+std::exception_ptr AsyncPipelineProvider::GetError(const T &description) const
+{
+    const PipelineKey key(description);
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    const auto it = entries_.find(key);
+    if (it == entries_.end() || !it->second->failed.load(std::memory_order_acquire))
+    {
+        return nullptr;
+    }
+    return it->second->error;
+}
+
+Pipeline AsyncPipelineProvider::Probe(const GraphicsPipelineDescription &description) const
+{
+    // returns no pipeline with VK_PIPELINE_COMPILE_REQUIRED_EXT if the pipeline is not in the cache
+    auto probeDescription = description;
+    probeDescription.flags |= VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT;
+    return std::move(device_->CreateGraphicsPipelines(probeDescription, GetPipelineCache(pipelineCache_)).front());
+}
+
+Pipeline AsyncPipelineProvider::Probe(const ComputePipelineDescription &description) const
+{
+    auto probeDescription = description;
+    probeDescription.flags |= VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT;
+    return std::move(device_->CreateComputePipelines(probeDescription, GetPipelineCache(pipelineCache_)).front());
+}
+
+std::future<Pipeline> AsyncPipelineProvider::Compile(const GraphicsPipelineDescription &description)
+{
+    // the job owns the copy, so it stays valid even if the provider is destroyed first
+    auto owned = std::make_shared<OwnedDescription<GraphicsPipelineDescription>>(description);
+
+    auto &state = owned->description.state;
+    state.tessellationState = CopyState(owned->tessellationState, state.tessellationState);
+    state.viewportState = CopyState(owned->viewportState, state.viewportState);
+    state.multisampleState = CopyState(owned->multisampleState, state.multisampleState);
+    if (state.multisampleState != nullptr && state.multisampleState->pSampleMask != nullptr)
+    {
+        const auto pSampleMask = state.multisampleState->pSampleMask;
+        owned->sampleMask.assign(pSampleMask, pSampleMask + (state.multisampleState->rasterizationSamples + 31) / 32);
+        state.multisampleState->pSampleMask = owned->sampleMask.data();
+    }
+    state.depthStencilState = CopyState(owned->depthStencilState, state.depthStencilState);
+    state.colorBlendState = CopyState(owned->colorBlendState, state.colorBlendState);
+    state.dynamicState = CopyState(owned->dynamicState, state.dynamicState);
+    for (auto &stage : owned->description.stages)
+    {
+        CopySpecialization(*owned, stage);
+    }
+
+    return compiler_->Submit([owned](const Device &device, const PipelineCache &pipelineCache)
+    {
+        return std::move(device.CreateGraphicsPipelines(owned->description, pipelineCache).front());
+    });
+}
+
+std::future<Pipeline> AsyncPipelineProvider::Compile(const ComputePipelineDescription &description)
+{
+    auto owned = std::make_shared<OwnedDescription<ComputePipelineDescription>>(description);
+    CopySpecialization(*owned, owned->description.stage);
+
+    return compiler_->Submit([owned](const Device &device, const PipelineCache &pipelineCache)
+    {
+        return std::move(device.CreateComputePipelines(owned->description, pipelineCache).front());
+    });
+}
+
+} // namespace vkw
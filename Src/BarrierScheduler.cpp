@@ -0,0 +1,203 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include <algorithm>
+
+#include "Error.h"
+
+namespace vkw
+{
+
+namespace
+{
+
+// the vector conversion of Span dereferences the first element, the pending barriers are usually empty
+template <typename T>
+Span<T> MakeSpan(const std::vector<T> &values)
+{
+    return Span<T>(values.data(), values.size());
+}
+
+} // namespace
+
+BarrierScheduler::~BarrierScheduler()
+{
+    if (eventPool_)
+    {
+        ReleaseEvents();
+    }
+}
+
+uint32_t BarrierScheduler::AddPass(RecordFunction record)
+{
+    assert(record);
+    passes_.emplace_back(std::move(record));
+    return static_cast<uint32_t>(passes_.size() - 1);
+}
+
+void BarrierScheduler::AddDependency(uint32_t producer, uint32_t consumer, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
+                                     const Span<MemoryBarrier> &memoryBarriers, const Span<VkBufferMemoryBarrier> &bufferMemoryBarriers,
+                                     const Span<VkImageMemoryBarrier> &imageMemoryBarriers)
+{
+    assert(producer < consumer && consumer < passes_.size());
+
+    Dependency dependency = {producer, consumer, srcStageMask, dstStageMask,
+                             static_cast<uint32_t>(memoryBarriers_.size()), memoryBarriers.Count(),
+                             static_cast<uint32_t>(bufferMemoryBarriers_.size()), bufferMemoryBarriers.Count(),
+                             static_cast<uint32_t>(imageMemoryBarriers_.size()), imageMemoryBarriers.Count()};
+    dependencies_.push_back(dependency);
+
+    memoryBarriers_.insert(memoryBarriers_.end(), memoryBarriers.begin(), memoryBarriers.end());
+    bufferMemoryBarriers_.insert(bufferMemoryBarriers_.end(), bufferMemoryBarriers.begin(), bufferMemoryBarriers.end());
+    imageMemoryBarriers_.insert(imageMemoryBarriers_.end(), imageMemoryBarriers.begin(), imageMemoryBarriers.end());
+}
+
+void BarrierScheduler::AppendBarriers(const Dependency &dependency)
+{
+    auto memoryBegin = memoryBarriers_.begin() + dependency.memoryBarrierOffset;
+    pendingMemoryBarriers_.insert(pendingMemoryBarriers_.end(), memoryBegin, memoryBegin + dependency.memoryBarrierCount);
+    auto bufferBegin = bufferMemoryBarriers_.begin() + dependency.bufferMemoryBarrierOffset;
+    pendingBufferMemoryBarriers_.insert(pendingBufferMemoryBarriers_.end(), bufferBegin, bufferBegin + dependency.bufferMemoryBarrierCount);
+    auto imageBegin = imageMemoryBarriers_.begin() + dependency.imageMemoryBarrierOffset;
+    pendingImageMemoryBarriers_.insert(pendingImageMemoryBarriers_.end(), imageBegin, imageBegin + dependency.imageMemoryBarrierCount);
+}
+
+void BarrierScheduler::Record(const CommandBuffer &commandBuffer)
+{
+    assert(eventPool_ && commandBuffer);
+
+    const auto passCount = static_cast<uint32_t>(passes_.size());
+
+    // a producer signals a single event for all of its split dependencies,
+    // the stage mask of the event is the union of their source stages
+    std::vector<VkPipelineStageFlags> eventStageMasks(passCount, 0);
+    for (const auto &dependency : dependencies_)
+    {
+        if (dependency.consumer != dependency.producer + 1)
+        {
+            eventStageMasks[dependency.producer] |= dependency.srcStageMask;
+        }
+    }
+
+    const auto firstEvent = events_.size();
+    std::vector<const Event*> passEvents(passCount, nullptr);
+    for (uint32_t i = 0; i < passCount; ++i)
+    {
+        if (eventStageMasks[i] != 0)
+        {
+            events_.emplace_back(eventPool_->Acquire());
+        }
+    }
+    for (uint32_t i = 0, e = 0; i < passCount; ++i)
+    {
+        if (eventStageMasks[i] != 0)
+        {
+            passEvents[i] = &events_[firstEvent + e++];
+        }
+    }
+
+    std::stable_sort(dependencies_.begin(), dependencies_.end(),
+                     [](const Dependency &a, const Dependency &b) { return a.consumer < b.consumer; });
+
+    std::vector<const Event*> waitEvents;
+    auto dependency = dependencies_.cbegin();
+    for (uint32_t pass = 0; pass < passCount; ++pass)
+    {
+        const auto end = std::find_if(dependency, dependencies_.cend(), [pass](const Dependency &d) { return d.consumer != pass; });
+
+        // adjacent producers are merged into a single pipeline barrier
+        VkPipelineStageFlags srcStageMask = 0;
+        VkPipelineStageFlags dstStageMask = 0;
+        for (auto it = dependency; it != end; ++it)
+        {
+            if (it->producer + 1 == pass)
+            {
+                srcStageMask |= it->srcStageMask;
+                dstStageMask |= it->dstStageMask;
+                AppendBarriers(*it);
+            }
+        }
+        if (srcStageMask != 0)
+        {
+            commandBuffer.PipelineBarrier(srcStageMask, dstStageMask, MakeSpan(pendingMemoryBarriers_), MakeSpan(pendingBufferMemoryBarriers_),
+                                          MakeSpan(pendingImageMemoryBarriers_));
+            pendingMemoryBarriers_.clear();
+            pendingBufferMemoryBarriers_.clear();
+            pendingImageMemoryBarriers_.clear();
+        }
+
+        // all other producers are waited on with a single vkCmdWaitEvents call
+        srcStageMask = 0;
+        dstStageMask = 0;
+        for (auto it = dependency; it != end; ++it)
+        {
+            if (it->producer + 1 != pass)
+            {
+                if (std::find(waitEvents.begin(), waitEvents.end(), passEvents[it->producer]) == waitEvents.end())
+                {
+                    waitEvents.push_back(passEvents[it->producer]);
+                    srcStageMask |= eventStageMasks[it->producer];
+                }
+                dstStageMask |= it->dstStageMask;
+                AppendBarriers(*it);
+            }
+        }
+        if (!waitEvents.empty())
+        {
+            commandBuffer.WaitEvents(Span2<Event>(waitEvents.data(), waitEvents.size()), srcStageMask, dstStageMask,
+                                     MakeSpan(pendingMemoryBarriers_), MakeSpan(pendingBufferMemoryBarriers_), MakeSpan(pendingImageMemoryBarriers_));
+            waitEvents.clear();
+            pendingMemoryBarriers_.clear();
+            pendingBufferMemoryBarriers_.clear();
+            pendingImageMemoryBarriers_.clear();
+        }
+
+        passes_[pass](commandBuffer);
+
+        if (passEvents[pass])
+        {
+            commandBuffer.SetEvent(*passEvents[pass], eventStageMasks[pass]);
+        }
+
+        dependency = end;
+    }
+
+    passes_.clear();
+    dependencies_.clear();
+    memoryBarriers_.clear();
+    bufferMemoryBarriers_.clear();
+    imageMemoryBarriers_.clear();
+}
+
+void BarrierScheduler::ReleaseEvents()
+{
+    assert(eventPool_);
+    for (auto &event : events_)
+    {
+        eventPool_->Release(std::move(event));
+    }
+    events_.clear();
+}
+
+} // namespace vkw
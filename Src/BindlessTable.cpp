@@ -0,0 +1,158 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include "Error.h"
+
+namespace vkw
+{
+
+void BindlessTable::FreeList::Init(uint32_t count)
+{
+    next_.reset(new std::atomic<uint32_t>[count]);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        next_[i].store(i + 1 < count ? i + 1 : InvalidIndex, std::memory_order_relaxed);
+    }
+    head_.store(count > 0 ? 0 : InvalidIndex);
+}
+
+uint32_t BindlessTable::FreeList::Pop()
+{
+    auto head = head_.load(std::memory_order_acquire);
+    for (;;)
+    {
+        const auto index = static_cast<uint32_t>(head);
+        if (index == InvalidIndex)
+        {
+            return InvalidIndex;
+        }
+
+        // the tag in the upper half changes with every successful exchange
+        const auto next = next_[index].load(std::memory_order_relaxed);
+        const auto newHead = ((head >> 32) + 1) << 32 | next;
+        if (head_.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire))
+        {
+            return index;
+        }
+    }
+}
+
+void BindlessTable::FreeList::Push(uint32_t index)
+{
+    auto head = head_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        next_[index].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        const auto newHead = ((head >> 32) + 1) << 32 | index;
+        if (head_.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+}
+
+BindlessTable::BindlessTable(const Device &device, uint32_t maxSampledImages, uint32_t maxStorageBuffers, uint32_t maxSamplers,
+                             VkShaderStageFlags stageFlags)
+    : device_(VkDevice(device))
+{
+    assert(device && maxSampledImages > 0 && maxStorageBuffers > 0 && maxSamplers > 0);
+
+    const VkDescriptorSetLayoutBinding bindings[BindingCount] = {
+        {SampledImageBinding, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, maxSampledImages, stageFlags, nullptr},
+        {StorageBufferBinding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxStorageBuffers, stageFlags, nullptr},
+        {SamplerBinding, VK_DESCRIPTOR_TYPE_SAMPLER, maxSamplers, stageFlags, nullptr}};
+
+    // unused slots are never accessed, so the arrays do not have to be filled
+    const VkDescriptorBindingFlags flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+    const VkDescriptorBindingFlags bindingFlags[BindingCount] = {flags, flags, flags};
+
+    setLayout_ = device.CreateDescriptorSetLayout(Span<VkDescriptorSetLayoutBinding>(bindings, BindingCount),
+                                                  Span<VkDescriptorBindingFlags>(bindingFlags, BindingCount),
+                                                  VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT);
+    pool_ = device.CreateDescriptorPool(1, {{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, maxSampledImages},
+                                            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxStorageBuffers},
+                                            {VK_DESCRIPTOR_TYPE_SAMPLER, maxSamplers}},
+                                        VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT);
+    set_ = pool_.AllocateDescriptorSet(setLayout_);
+
+    freeLists_[SampledImageBinding].Init(maxSampledImages);
+    freeLists_[StorageBufferBinding].Init(maxStorageBuffers);
+    freeLists_[SamplerBinding].Init(maxSamplers);
+}
+
+uint32_t BindlessTable::AddSampledImage(const ImageView &imageView, VkImageLayout imageLayout)
+{
+    assert(set_ && imageView);
+
+    const auto index = freeLists_[SampledImageBinding].Pop();
+    if (index != InvalidIndex)
+    {
+        VkDescriptorImageInfo imageInfo = {VK_NULL_HANDLE, VkImageView(imageView), imageLayout};
+        Write({VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, VkDescriptorSet(set_), SampledImageBinding, index, 1,
+               VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, &imageInfo, nullptr, nullptr});
+    }
+    return index;
+}
+
+uint32_t BindlessTable::AddStorageBuffer(const Buffer &buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    assert(set_ && buffer);
+
+    const auto index = freeLists_[StorageBufferBinding].Pop();
+    if (index != InvalidIndex)
+    {
+        VkDescriptorBufferInfo bufferInfo = {VkBuffer(buffer), offset, range};
+        Write({VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, VkDescriptorSet(set_), StorageBufferBinding, index, 1,
+               VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &bufferInfo, nullptr});
+    }
+    return index;
+}
+
+uint32_t BindlessTable::AddSampler(const Sampler &sampler)
+{
+    assert(set_ && sampler);
+
+    const auto index = freeLists_[SamplerBinding].Pop();
+    if (index != InvalidIndex)
+    {
+        VkDescriptorImageInfo imageInfo = {VkSampler(sampler), VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED};
+        Write({VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, VkDescriptorSet(set_), SamplerBinding, index, 1,
+               VK_DESCRIPTOR_TYPE_SAMPLER, &imageInfo, nullptr, nullptr});
+    }
+    return index;
+}
+
+void BindlessTable::Remove(Binding binding, uint32_t index)
+{
+    assert(binding < BindingCount && index != InvalidIndex);
+    freeLists_[binding].Push(index);
+}
+
+void BindlessTable::Write(const VkWriteDescriptorSet &write)
+{
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+}
+
+} // namespace vkw
@@ -248,6 +248,61 @@ void CommandBuffer::PushConstants(const PipelineLayout &layout, VkShaderStageFla
     vkCmdPushConstants(cmdBuffer_, VkPipelineLayout(layout), stageFlags, offset, size, pValues);
 }
 
+void CommandBuffer::PushDescriptorSet(const Device &device, VkPipelineBindPoint pipelineBindPoint, const PipelineLayout &layout, uint32_t set,
+                                      const Span<VkWriteDescriptorSet> &descriptorWrites) const
+{
+    const auto pfnCmdPushDescriptorSet = device.GetPushDescriptorFunctions().cmdPushDescriptorSet;
+    assert(cmdBuffer_ && layout && descriptorWrites && pfnCmdPushDescriptorSet);
+    pfnCmdPushDescriptorSet(cmdBuffer_, pipelineBindPoint, VkPipelineLayout(layout), set, descriptorWrites.Count(), descriptorWrites.Data());
+}
+
+void CommandBuffer::PushDescriptorSet(const Device &device, VkPipelineBindPoint pipelineBindPoint, const PipelineLayout &layout, uint32_t set, uint32_t binding,
+                                      VkDescriptorType descriptorType, const Span<DescriptorBufferInfo> &bufferInfo) const
+{
+    assert(bufferInfo);
+
+    const auto descriptorCount = bufferInfo.Count();
+    auto *pBufferInfo = static_cast<VkDescriptorBufferInfo*>(alloca(sizeof(VkDescriptorBufferInfo) * descriptorCount));
+    bufferInfo.Emplace(pBufferInfo);
+    VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, VK_NULL_HANDLE, binding, 0, descriptorCount,
+                                  descriptorType, nullptr, pBufferInfo, nullptr};
+    PushDescriptorSet(device, pipelineBindPoint, layout, set, write);
+}
+
+void CommandBuffer::PushDescriptorSet(const Device &device, VkPipelineBindPoint pipelineBindPoint, const PipelineLayout &layout, uint32_t set, uint32_t binding,
+                                      VkDescriptorType descriptorType, const Span<DescriptorImageInfo> &imageInfo) const
+{
+    assert(imageInfo);
+
+    const auto descriptorCount = imageInfo.Count();
+    auto *pImageInfo = static_cast<VkDescriptorImageInfo*>(alloca(sizeof(VkDescriptorImageInfo) * descriptorCount));
+    imageInfo.Emplace(pImageInfo);
+    VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, VK_NULL_HANDLE, binding, 0, descriptorCount,
+                                  descriptorType, pImageInfo, nullptr, nullptr};
+    PushDescriptorSet(device, pipelineBindPoint, layout, set, write);
+}
+
+void CommandBuffer::PushDescriptorSet(const Device &device, VkPipelineBindPoint pipelineBindPoint, const PipelineLayout &layout, uint32_t set, uint32_t binding,
+                                      VkDescriptorType descriptorType, const Span2<BufferView> &bufferViews) const
+{
+    assert(bufferViews);
+
+    const auto descriptorCount = bufferViews.Count();
+    auto *pBufferViews = static_cast<VkBufferView*>(alloca(sizeof(VkBufferView) * descriptorCount));
+    bufferViews.Emplace(pBufferViews);
+    VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, VK_NULL_HANDLE, binding, 0, descriptorCount,
+                                  descriptorType, nullptr, nullptr, pBufferViews};
+    PushDescriptorSet(device, pipelineBindPoint, layout, set, write);
+}
+
+void CommandBuffer::PushDescriptorSetWithTemplate(const Device &device, const DescriptorUpdateTemplate &updateTemplate, const PipelineLayout &layout, uint32_t set,
+                                                  const void *pData) const
+{
+    const auto pfnCmdPushDescriptorSetWithTemplate = device.GetPushDescriptorFunctions().cmdPushDescriptorSetWithTemplate;
+    assert(cmdBuffer_ && updateTemplate && layout && pData && pfnCmdPushDescriptorSetWithTemplate);
+    pfnCmdPushDescriptorSetWithTemplate(cmdBuffer_, VkDescriptorUpdateTemplate(updateTemplate), VkPipelineLayout(layout), set, pData);
+}
+
 void CommandBuffer::SetViewport(const VkViewport &viewport, uint32_t firstViewport) const
 {
     assert(cmdBuffer_);
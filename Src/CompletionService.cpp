@@ -0,0 +1,129 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include "Error.h"
+
+namespace vkw
+{
+
+bool CompletionHandle::IsComplete() const
+{
+    assert(state_);
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->complete;
+}
+
+const CompletionHandle& CompletionHandle::Then(Callback callback) const
+{
+    assert(state_ && callback);
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (!state_->complete)
+        {
+            state_->callbacks.emplace_back(std::move(callback));
+            return *this;
+        }
+    }
+
+    callback();
+    return *this;
+}
+
+VkResult CompletionHandle::Wait() const
+{
+    assert(state_);
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->cv.wait(lock, [this] { return state_->complete; });
+    return state_->result;
+}
+
+CompletionService::CompletionService(const Device &device, FenceWatcher::Executor executor, uint32_t initialFenceCount)
+    : fencePool_(std::make_shared<FencePool>(device, initialFenceCount))
+    , executor_(std::move(executor))
+    , watcher_(device)
+{}
+
+Fence CompletionService::AcquireFence()
+{
+    return fencePool_->Acquire();
+}
+
+CompletionHandle CompletionService::Track(Fence &&fence)
+{
+    assert(fence);
+
+    auto state = std::make_shared<CompletionHandle::State>();
+    state->fence = std::move(fence);
+
+    // runs on the watcher thread, which is joined before the service goes away,
+    // the part handed to the executor only holds shared state
+    watcher_.Watch(state->fence, [this, state]() {
+        auto complete = [fencePool = fencePool_, state, result = watcher_.GetResult()]() {
+            Complete(*fencePool, *state, result);
+        };
+        if (executor_)
+        {
+            executor_(std::move(complete));
+        }
+        else
+        {
+            complete();
+        }
+    });
+
+    return CompletionHandle(std::move(state));
+}
+
+void CompletionService::Complete(FencePool &fencePool, CompletionHandle::State &state, VkResult result)
+{
+    std::vector<CompletionHandle::Callback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        callbacks.swap(state.callbacks);
+    }
+
+    // callbacks added meanwhile see complete == false and are picked up below
+    for (;;)
+    {
+        for (auto &callback : callbacks)
+        {
+            callback();
+        }
+        callbacks.clear();
+
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.callbacks.empty())
+        {
+            state.complete = true;
+            state.result = result;
+            break;
+        }
+        callbacks.swap(state.callbacks);
+    }
+    state.cv.notify_all();
+
+    fencePool.Release(std::move(state.fence), true);
+}
+
+} // namespace vkw
@@ -0,0 +1,119 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include <algorithm>
+
+#include "Error.h"
+
+namespace vkw
+{
+
+DescriptorAllocator::DescriptorAllocator(const Device &device, uint32_t frameCount, uint32_t threadCount, const Span<PoolSizeRatio> &poolSizeRatios,
+                                         uint32_t initialSetsPerPool, float growthFactor, uint32_t maxSetsPerPool)
+    : device_(VkDevice(device))
+    , threadCount_(threadCount)
+    , poolSizeRatios_(poolSizeRatios.begin(), poolSizeRatios.end())
+    , growthFactor_(growthFactor)
+    , maxSetsPerPool_(maxSetsPerPool)
+    , chains_(frameCount * threadCount)
+{
+    assert(device && frameCount > 0 && threadCount > 0 && poolSizeRatios && initialSetsPerPool > 0 && growthFactor >= 1.0f);
+
+    for (auto &chain : chains_)
+    {
+        chain.nextSetsPerPool = std::min(initialSetsPerPool, maxSetsPerPool);
+    }
+}
+
+void DescriptorAllocator::BeginFrame()
+{
+    assert(device_);
+
+    frameIndex_ = (frameIndex_ + 1) % static_cast<uint32_t>(chains_.size() / threadCount_);
+    for (uint32_t i = 0; i < threadCount_; ++i)
+    {
+        auto &chain = chains_[frameIndex_ * threadCount_ + i];
+        for (size_t j = 0; j < std::min(chain.current + 1, chain.pools.size()); ++j)
+        {
+            chain.pools[j].Reset();
+        }
+        chain.current = 0;
+    }
+}
+
+DescriptorSet DescriptorAllocator::Allocate(const DescriptorSetLayout &setLayout, uint32_t threadIndex)
+{
+    return AllocateExt(nullptr, setLayout, threadIndex);
+}
+
+DescriptorSet DescriptorAllocator::AllocateExt(const void *pNext, const DescriptorSetLayout &setLayout, uint32_t threadIndex)
+{
+    assert(device_ && setLayout && threadIndex < threadCount_);
+
+    auto &chain = chains_[frameIndex_ * threadCount_ + threadIndex];
+    auto vkSetLayout = VkDescriptorSetLayout(setLayout);
+
+    for (;;)
+    {
+        const bool newPool = chain.current == chain.pools.size();
+        if (newPool)
+        {
+            chain.pools.emplace_back(CreatePool(chain.nextSetsPerPool));
+            chain.nextSetsPerPool = std::min(static_cast<uint32_t>(chain.nextSetsPerPool * growthFactor_), maxSetsPerPool_);
+        }
+
+        VkDescriptorSetAllocateInfo allocateInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO, pNext,
+                                                    VkDescriptorPool(chain.pools[chain.current]), 1, &vkSetLayout};
+        VkDescriptorSet descriptorSet;
+        const auto result = vkAllocateDescriptorSets(device_, &allocateInfo, &descriptorSet);
+        if (result == VK_SUCCESS)
+        {
+            return DescriptorSet(descriptorSet);
+        }
+
+        // a set which does not fit into an empty pool needs other ratios, growing the chain would not help
+        if (newPool || (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL))
+        {
+            VK_CALL(result);
+        }
+        ++chain.current;
+    }
+}
+
+DescriptorPool DescriptorAllocator::CreatePool(uint32_t maxSets) const
+{
+    const auto poolSizeCount = static_cast<uint32_t>(poolSizeRatios_.size());
+    auto pPoolSizes = static_cast<VkDescriptorPoolSize*>(alloca(sizeof(VkDescriptorPoolSize) * poolSizeCount));
+    for (uint32_t i = 0; i < poolSizeCount; ++i)
+    {
+        pPoolSizes[i] = {poolSizeRatios_[i].type, std::max(1u, static_cast<uint32_t>(poolSizeRatios_[i].ratio * maxSets))};
+    }
+
+    const VkDescriptorPoolCreateInfo createInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO, nullptr, 0, maxSets, poolSizeCount, pPoolSizes};
+    VkDescriptorPool descriptorPool;
+    VK_CALL(vkCreateDescriptorPool(device_, &createInfo, nullptr, &descriptorPool));
+    return DescriptorPool(device_, descriptorPool);
+}
+
+} // namespace vkw
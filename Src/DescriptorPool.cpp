@@ -49,6 +49,12 @@ DescriptorSet DescriptorPool::AllocateDescriptorSetExt(const void *pNext, const
 
     return DescriptorSet(descriptorSet);
 }
+DescriptorSet DescriptorPool::AllocateDescriptorSet(const DescriptorSetLayout &setLayout, uint32_t variableDescriptorCount) const
+{
+    VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO, nullptr,
+                                                                            1, &variableDescriptorCount};
+    return AllocateDescriptorSetExt(&variableCountInfo, setLayout);
+}
 std::vector<DescriptorSet> DescriptorPool::AllocateDescriptorSets(const Span2<DescriptorSetLayout> &setLayouts) const
 {
     return AllocateDescriptorSetsExt(nullptr, setLayouts);
@@ -0,0 +1,298 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include <algorithm>
+
+#include "Error.h"
+
+namespace
+{
+
+void HashCombine(size_t &hash, uint64_t value)
+{
+    hash ^= static_cast<size_t>(value + 0x9e3779b97f4a7c15ull) + (hash << 6) + (hash >> 2);
+}
+
+// non dispatchable handles are pointers on 64 bit platforms and uint64_t otherwise
+template <typename T>
+uint64_t HandleBits(T *handle)
+{
+    return reinterpret_cast<uintptr_t>(handle);
+}
+
+uint64_t HandleBits(uint64_t handle)
+{
+    return handle;
+}
+
+} // namespace
+
+namespace vkw
+{
+
+DescriptorSetCache::Key::Key(const DescriptorSetLayout &setLayout)
+{
+    Reset(setLayout);
+}
+
+void DescriptorSetCache::Key::Reset(const DescriptorSetLayout &setLayout)
+{
+    assert(setLayout);
+    setLayout_ = VkDescriptorSetLayout(setLayout);
+    bindings_.clear();
+    bufferInfos_.clear();
+    imageInfos_.clear();
+    bufferViews_.clear();
+    hash_ = 0;
+    HashCombine(hash_, HandleBits(setLayout_));
+}
+
+void DescriptorSetCache::Key::AppendBinding(uint32_t binding, VkDescriptorType descriptorType, size_t offset, uint32_t descriptorCount)
+{
+    bindings_.push_back({binding, descriptorType, static_cast<uint32_t>(offset), descriptorCount});
+    HashCombine(hash_, (static_cast<uint64_t>(binding) << 32) | static_cast<uint64_t>(descriptorType));
+    HashCombine(hash_, descriptorCount);
+}
+
+DescriptorSetCache::Key& DescriptorSetCache::Key::Bind(uint32_t binding, VkDescriptorType descriptorType, const Span<DescriptorBufferInfo> &bufferInfo)
+{
+    assert(setLayout_ && bufferInfo);
+
+    const auto offset = bufferInfos_.size();
+    bufferInfos_.resize(offset + bufferInfo.Count());
+    bufferInfo.Emplace(bufferInfos_.data() + offset);
+    AppendBinding(binding, descriptorType, offset, bufferInfo.Count());
+
+    for (auto i = offset; i < bufferInfos_.size(); ++i)
+    {
+        HashCombine(hash_, HandleBits(bufferInfos_[i].buffer));
+        HashCombine(hash_, bufferInfos_[i].offset);
+        HashCombine(hash_, bufferInfos_[i].range);
+    }
+    return *this;
+}
+
+DescriptorSetCache::Key& DescriptorSetCache::Key::Bind(uint32_t binding, VkDescriptorType descriptorType, const Span<DescriptorImageInfo> &imageInfo)
+{
+    assert(setLayout_ && imageInfo);
+
+    const auto offset = imageInfos_.size();
+    imageInfos_.resize(offset + imageInfo.Count());
+    imageInfo.Emplace(imageInfos_.data() + offset);
+    AppendBinding(binding, descriptorType, offset, imageInfo.Count());
+
+    for (auto i = offset; i < imageInfos_.size(); ++i)
+    {
+        HashCombine(hash_, HandleBits(imageInfos_[i].sampler));
+        HashCombine(hash_, HandleBits(imageInfos_[i].imageView));
+        HashCombine(hash_, imageInfos_[i].imageLayout);
+    }
+    return *this;
+}
+
+DescriptorSetCache::Key& DescriptorSetCache::Key::Bind(uint32_t binding, VkDescriptorType descriptorType, const Span2<BufferView> &bufferViews)
+{
+    assert(setLayout_ && bufferViews);
+
+    const auto offset = bufferViews_.size();
+    bufferViews_.resize(offset + bufferViews.Count());
+    bufferViews.Emplace(bufferViews_.data() + offset);
+    AppendBinding(binding, descriptorType, offset, bufferViews.Count());
+
+    for (auto i = offset; i < bufferViews_.size(); ++i)
+    {
+        HashCombine(hash_, HandleBits(bufferViews_[i]));
+    }
+    return *this;
+}
+
+bool DescriptorSetCache::Key::operator==(const Key &other) const
+{
+    if (hash_ != other.hash_ || setLayout_ != other.setLayout_ || bindings_.size() != other.bindings_.size() ||
+        bufferInfos_.size() != other.bufferInfos_.size() || imageInfos_.size() != other.imageInfos_.size() || bufferViews_.size() != other.bufferViews_.size())
+    {
+        return false;
+    }
+
+    auto equalBindings = [](const Binding &a, const Binding &b) {
+        return a.binding == b.binding && a.descriptorType == b.descriptorType && a.offset == b.offset && a.descriptorCount == b.descriptorCount; };
+    auto equalBufferInfos = [](const VkDescriptorBufferInfo &a, const VkDescriptorBufferInfo &b) {
+        return a.buffer == b.buffer && a.offset == b.offset && a.range == b.range; };
+    auto equalImageInfos = [](const VkDescriptorImageInfo &a, const VkDescriptorImageInfo &b) {
+        return a.sampler == b.sampler && a.imageView == b.imageView && a.imageLayout == b.imageLayout; };
+
+    return std::equal(bindings_.begin(), bindings_.end(), other.bindings_.begin(), equalBindings) &&
+           std::equal(bufferInfos_.begin(), bufferInfos_.end(), other.bufferInfos_.begin(), equalBufferInfos) &&
+           std::equal(imageInfos_.begin(), imageInfos_.end(), other.imageInfos_.begin(), equalImageInfos) &&
+           std::equal(bufferViews_.begin(), bufferViews_.end(), other.bufferViews_.begin());
+}
+
+DescriptorSetCache::DescriptorSetCache(const Device &device, uint32_t maxSets, const Span<VkDescriptorPoolSize> &poolSizes, uint32_t frameCount)
+    : device_(VkDevice(device))
+    , pool_(device.CreateDescriptorPool(maxSets, poolSizes, VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT))
+    , frameCount_(frameCount)
+{
+    assert(frameCount > 0);
+    lookup_.reserve(maxSets);
+}
+
+DescriptorSet DescriptorSetCache::Get(const Key &key)
+{
+    assert(device_ && key.setLayout_);
+
+    auto it = lookup_.find(&key);
+    if (it != lookup_.end())
+    {
+        entries_.splice(entries_.begin(), entries_, it->second);
+        it->second->lastUsedFrame = frame_;
+        return DescriptorSet(it->second->descriptorSet);
+    }
+
+    const auto descriptorSet = Allocate(key.setLayout_);
+
+    const auto writeCount = static_cast<uint32_t>(key.bindings_.size());
+    auto pWrites = static_cast<VkWriteDescriptorSet*>(alloca(sizeof(VkWriteDescriptorSet) * writeCount));
+    for (uint32_t i = 0; i < writeCount; ++i)
+    {
+        const auto &binding = key.bindings_[i];
+        pWrites[i] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, descriptorSet, binding.binding, 0, binding.descriptorCount,
+                      binding.descriptorType, nullptr, nullptr, nullptr};
+        switch (binding.descriptorType)
+        {
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+            pWrites[i].pImageInfo = key.imageInfos_.data() + binding.offset;
+            break;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+            pWrites[i].pTexelBufferView = key.bufferViews_.data() + binding.offset;
+            break;
+        default:
+            pWrites[i].pBufferInfo = key.bufferInfos_.data() + binding.offset;
+            break;
+        }
+    }
+    vkUpdateDescriptorSets(device_, writeCount, pWrites, 0, nullptr);
+
+    entries_.push_front({key, descriptorSet, frame_});
+    lookup_.emplace(&entries_.front().key, entries_.begin());
+    return DescriptorSet(descriptorSet);
+}
+
+void DescriptorSetCache::BeginFrame()
+{
+    assert(device_);
+    ++frame_;
+
+    auto inUse = [this](const std::pair<VkDescriptorSet, uint64_t> &retired) { return retired.second + frameCount_ > frame_; };
+    auto firstUnused = std::partition(retired_.begin(), retired_.end(), inUse);
+    if (firstUnused == retired_.end())
+    {
+        return;
+    }
+
+    const auto descriptorSetCount = static_cast<uint32_t>(retired_.end() - firstUnused);
+    auto pDescriptorSets = static_cast<VkDescriptorSet*>(alloca(sizeof(VkDescriptorSet) * descriptorSetCount));
+    std::transform(firstUnused, retired_.end(), pDescriptorSets, [](const std::pair<VkDescriptorSet, uint64_t> &retired) { return retired.first; });
+    VK_CALL(vkFreeDescriptorSets(device_, VkDescriptorPool(pool_), descriptorSetCount, pDescriptorSets));
+    retired_.erase(firstUnused, retired_.end());
+}
+
+void DescriptorSetCache::Invalidate(const Buffer &buffer)
+{
+    const auto vkBuffer = VkBuffer(buffer);
+    InvalidateIf([vkBuffer](const Key &key) {
+        return std::any_of(key.bufferInfos_.begin(), key.bufferInfos_.end(), [vkBuffer](const VkDescriptorBufferInfo &info) { return info.buffer == vkBuffer; }); });
+}
+
+void DescriptorSetCache::Invalidate(const BufferView &bufferView)
+{
+    const auto vkBufferView = VkBufferView(bufferView);
+    InvalidateIf([vkBufferView](const Key &key) {
+        return std::find(key.bufferViews_.begin(), key.bufferViews_.end(), vkBufferView) != key.bufferViews_.end(); });
+}
+
+void DescriptorSetCache::Invalidate(const ImageView &imageView)
+{
+    const auto vkImageView = VkImageView(imageView);
+    InvalidateIf([vkImageView](const Key &key) {
+        return std::any_of(key.imageInfos_.begin(), key.imageInfos_.end(), [vkImageView](const VkDescriptorImageInfo &info) { return info.imageView == vkImageView; }); });
+}
+
+template <typename F>
+void DescriptorSetCache::InvalidateIf(F references)
+{
+    for (auto it = entries_.begin(); it != entries_.end();)
+    {
+        if (references(it->key))
+        {
+            retired_.emplace_back(it->descriptorSet, it->lastUsedFrame);
+            lookup_.erase(&it->key);
+            it = entries_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+VkDescriptorSet DescriptorSetCache::Allocate(VkDescriptorSetLayout setLayout)
+{
+    VkDescriptorSetAllocateInfo allocateInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO, nullptr, VkDescriptorPool(pool_), 1, &setLayout};
+
+    for (;;)
+    {
+        VkDescriptorSet descriptorSet;
+        const auto result = vkAllocateDescriptorSets(device_, &allocateInfo, &descriptorSet);
+        if (result == VK_SUCCESS)
+        {
+            return descriptorSet;
+        }
+
+        if ((result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) || !EvictLeastRecentlyUsed())
+        {
+            VK_CALL(result);
+        }
+    }
+}
+
+bool DescriptorSetCache::EvictLeastRecentlyUsed()
+{
+    if (entries_.empty() || entries_.back().lastUsedFrame + frameCount_ > frame_)
+    {
+        return false;
+    }
+
+    auto &entry = entries_.back();
+    VK_CALL(vkFreeDescriptorSets(device_, VkDescriptorPool(pool_), 1, &entry.descriptorSet));
+    lookup_.erase(&entry.key);
+    entries_.pop_back();
+    return true;
+}
+
+} // namespace vkw
@@ -0,0 +1,191 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include <cstring>
+
+#include "Error.h"
+
+namespace vkw
+{
+
+DescriptorWriter::DescriptorWriter(const Device &device)
+    : device_(VkDevice(device))
+{
+    assert(device);
+}
+
+DescriptorWriter& DescriptorWriter::Write(const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement, VkDescriptorType descriptorType,
+                                          const Span<DescriptorBufferInfo> &bufferInfo)
+{
+    return WriteExt(nullptr, dstSet, dstBinding, dstStartingArrayElement, descriptorType, bufferInfo);
+}
+
+DescriptorWriter& DescriptorWriter::WriteExt(const void *pNext, const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement,
+                                             VkDescriptorType descriptorType, const Span<DescriptorBufferInfo> &bufferInfo)
+{
+    assert(dstSet && bufferInfo);
+
+    const auto offset = bufferInfos_.size();
+    bufferInfos_.resize(offset + bufferInfo.Count());
+    bufferInfo.Emplace(bufferInfos_.data() + offset);
+
+    // the info pointers are resolved in Flush, the arena may still grow until then
+    writes_.push_back({VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, pNext, VkDescriptorSet(dstSet), dstBinding, dstStartingArrayElement, bufferInfo.Count(),
+                       descriptorType, nullptr, nullptr, nullptr});
+    infoOffsets_.push_back(offset);
+    return *this;
+}
+
+DescriptorWriter& DescriptorWriter::Write(const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement,
+                                          VkDescriptorType descriptorType, const Span<DescriptorImageInfo> &imageInfo)
+{
+    return WriteExt(nullptr, dstSet, dstBinding, dstStartingArrayElement, descriptorType, imageInfo);
+}
+
+DescriptorWriter& DescriptorWriter::WriteExt(const void *pNext, const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement,
+                                             VkDescriptorType descriptorType, const Span<DescriptorImageInfo> &imageInfo)
+{
+    assert(dstSet && imageInfo);
+
+    const auto offset = imageInfos_.size();
+    imageInfos_.resize(offset + imageInfo.Count());
+    imageInfo.Emplace(imageInfos_.data() + offset);
+
+    writes_.push_back({VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, pNext, VkDescriptorSet(dstSet), dstBinding, dstStartingArrayElement, imageInfo.Count(),
+                       descriptorType, nullptr, nullptr, nullptr});
+    infoOffsets_.push_back(offset);
+    return *this;
+}
+
+DescriptorWriter& DescriptorWriter::Write(const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement,
+                                          VkDescriptorType descriptorType, const Span2<BufferView> &bufferViews)
+{
+    return WriteExt(nullptr, dstSet, dstBinding, dstStartingArrayElement, descriptorType, bufferViews);
+}
+
+DescriptorWriter& DescriptorWriter::WriteExt(const void *pNext, const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement,
+                                             VkDescriptorType descriptorType, const Span2<BufferView> &bufferViews)
+{
+    assert(dstSet && bufferViews);
+
+    const auto offset = bufferViews_.size();
+    bufferViews_.resize(offset + bufferViews.Count());
+    bufferViews.Emplace(bufferViews_.data() + offset);
+
+    writes_.push_back({VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, pNext, VkDescriptorSet(dstSet), dstBinding, dstStartingArrayElement, bufferViews.Count(),
+                       descriptorType, nullptr, nullptr, nullptr});
+    infoOffsets_.push_back(offset);
+    return *this;
+}
+
+DescriptorWriter& DescriptorWriter::Copy(const DescriptorSet &srcSet, uint32_t srcBinding, uint32_t srcStartingArrayElement,
+                                         const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement, uint32_t descriptorCount)
+{
+    return CopyExt(nullptr, srcSet, srcBinding, srcStartingArrayElement, dstSet, dstBinding, dstStartingArrayElement, descriptorCount);
+}
+
+DescriptorWriter& DescriptorWriter::CopyExt(const void *pNext, const DescriptorSet &srcSet, uint32_t srcBinding, uint32_t srcStartingArrayElement,
+                                            const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstStartingArrayElement, uint32_t descriptorCount)
+{
+    assert(srcSet && dstSet);
+
+    copies_.push_back({VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET, pNext, VkDescriptorSet(srcSet), srcBinding, srcStartingArrayElement,
+                       VkDescriptorSet(dstSet), dstBinding, dstStartingArrayElement, descriptorCount});
+    return *this;
+}
+
+DescriptorWriter& DescriptorWriter::WriteInlineUniformBlock(const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstByteOffset, const void *pData, uint32_t dataSize)
+{
+    assert(dstSet && pData && dataSize > 0);
+
+    const auto dataOffset = inlineUniformBlockData_.size();
+    inlineUniformBlockData_.resize(dataOffset + dataSize);
+    std::memcpy(inlineUniformBlockData_.data() + dataOffset, pData, dataSize);
+
+    writes_.push_back({VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, VkDescriptorSet(dstSet), dstBinding, dstByteOffset, dataSize,
+                       VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT, nullptr, nullptr, nullptr});
+    infoOffsets_.push_back(inlineUniformBlocks_.size());
+    inlineUniformBlocks_.push_back({VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_INLINE_UNIFORM_BLOCK_EXT, nullptr, dataSize, nullptr});
+    inlineUniformBlockDataOffsets_.push_back(dataOffset);
+    return *this;
+}
+
+void DescriptorWriter::Flush()
+{
+    assert(device_);
+
+    if (IsEmpty())
+    {
+        return;
+    }
+
+    // the descriptor type selects the info array just like it does for vkUpdateDescriptorSets
+    for (size_t i = 0; i < writes_.size(); ++i)
+    {
+        auto &write = writes_[i];
+        switch (write.descriptorType)
+        {
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+            write.pImageInfo = imageInfos_.data() + infoOffsets_[i];
+            break;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+            write.pTexelBufferView = bufferViews_.data() + infoOffsets_[i];
+            break;
+        case VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT:
+        {
+            auto &inlineUniformBlock = inlineUniformBlocks_[infoOffsets_[i]];
+            inlineUniformBlock.pData = inlineUniformBlockData_.data() + inlineUniformBlockDataOffsets_[infoOffsets_[i]];
+            write.pNext = &inlineUniformBlock;
+            break;
+        }
+        default:
+            write.pBufferInfo = bufferInfos_.data() + infoOffsets_[i];
+            break;
+        }
+    }
+
+    vkUpdateDescriptorSets(device_, static_cast<uint32_t>(writes_.size()), writes_.data(),
+                           static_cast<uint32_t>(copies_.size()), copies_.data());
+    Clear();
+}
+
+void DescriptorWriter::Clear()
+{
+    writes_.clear();
+    infoOffsets_.clear();
+    copies_.clear();
+    bufferInfos_.clear();
+    imageInfos_.clear();
+    bufferViews_.clear();
+    inlineUniformBlocks_.clear();
+    inlineUniformBlockDataOffsets_.clear();
+    inlineUniformBlockData_.clear();
+}
+
+} // namespace vkw
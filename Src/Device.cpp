@@ -22,15 +22,63 @@ SOFTWARE.
 
 #include "VulkanWrapper.h"
 
+#include <string>
+#include <utility>
+
 #include "Error.h"
+#include "Serialization.h"
+#include "SpinWait.h"
+
+namespace
+{
+
+template <typename T, typename F>
+const T& GetOrCreate(std::mutex &mutex, std::unordered_map<std::string, T> &cache, std::string &&key, F create)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto it = cache.find(key);
+        if (it != cache.end())
+        {
+            return it->second;
+        }
+    }
+
+    // created outside of the lock, if another thread has been faster its object wins and this one is destroyed after unlocking
+    auto object = create();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.try_emplace(std::move(key), std::move(object)).first->second;
+}
+
+} // namespace
 
 namespace vkw
 {
 
+namespace Impl
+{
+
+// keys are the serialized create infos, references to mapped values stay valid on rehashing
+struct ObjectCaches
+{
+    std::mutex mutex;
+    std::unordered_map<std::string, DescriptorSetLayout> descriptorSetLayouts;
+    std::unordered_map<std::string, PipelineLayout> pipelineLayouts;
+    std::unordered_map<std::string, Sampler> samplers;
+    std::unordered_map<std::string, RenderPass> renderPasses;
+};
+
+} // namespace Impl
+
 Device::Device(VkDevice device)
     : device_(device)
 {
     assert(device);
+    pushDescriptorFunctions_.cmdPushDescriptorSet = reinterpret_cast<PFN_vkCmdPushDescriptorSetKHR>(
+        vkGetDeviceProcAddr(device, "vkCmdPushDescriptorSetKHR"));
+    pushDescriptorFunctions_.cmdPushDescriptorSetWithTemplate = reinterpret_cast<PFN_vkCmdPushDescriptorSetWithTemplateKHR>(
+        vkGetDeviceProcAddr(device, "vkCmdPushDescriptorSetWithTemplateKHR"));
 }
 
 void Device::WaitIdle() const
@@ -240,6 +288,116 @@ Sampler Device::CreateSampler(const SamplerDescription &samplerDescription) cons
     return Sampler(device_, sampler);
 }
 
+Device Device::GetView() const
+{
+    Device view;
+    VkDevice device = device_;
+    view.device_ = Impl::DispatchableObject<VkDevice, vkDestroyDevice>(device, false);
+    view.objectCaches_ = objectCaches_;
+    view.pipelineManifest_ = pipelineManifest_;
+    view.pushDescriptorFunctions_ = pushDescriptorFunctions_;
+    return view;
+}
+
+void Device::EnableObjectCaches()
+{
+    assert(device_);
+    if (!objectCaches_)
+    {
+        objectCaches_ = std::make_shared<Impl::ObjectCaches>();
+    }
+}
+
+const DescriptorSetLayout& Device::GetDescriptorSetLayout(const Span<VkDescriptorSetLayoutBinding> &bindings, VkDescriptorSetLayoutCreateFlags flags) const
+{
+    assert(objectCaches_);
+
+    std::string key;
+    AppendBytes(key, flags);
+    for (const auto &binding : bindings)
+    {
+        AppendBytes(key, binding.binding);
+        AppendBytes(key, binding.descriptorType);
+        AppendBytes(key, binding.descriptorCount);
+        AppendBytes(key, binding.stageFlags);
+        const bool immutableSamplers = binding.pImmutableSamplers != nullptr;
+        AppendBytes(key, immutableSamplers);
+        if (immutableSamplers)
+        {
+            key.append(reinterpret_cast<const char*>(binding.pImmutableSamplers), sizeof(VkSampler) * binding.descriptorCount);
+        }
+    }
+
+    return GetOrCreate(objectCaches_->mutex, objectCaches_->descriptorSetLayouts, std::move(key),
+                       [&]() { return CreateDescriptorSetLayout(bindings, flags); });
+}
+
+const PipelineLayout& Device::GetPipelineLayout(const Span2<DescriptorSetLayout> &setLayouts, const Span<VkPushConstantRange> &pushConstantRanges,
+                                                VkPipelineLayoutCreateFlags flags) const
+{
+    assert(objectCaches_);
+
+    std::string key;
+    AppendBytes(key, flags);
+    AppendBytes(key, setLayouts.Count());
+    for (uint32_t i = 0; i < setLayouts.Count(); ++i)
+    {
+        AppendBytes(key, VkDescriptorSetLayout(setLayouts[i]));
+    }
+    for (const auto &range : pushConstantRanges)
+    {
+        AppendBytes(key, range);
+    }
+
+    return GetOrCreate(objectCaches_->mutex, objectCaches_->pipelineLayouts, std::move(key),
+                       [&]() { return CreatePipelineLayout(setLayouts, pushConstantRanges, flags); });
+}
+
+const Sampler& Device::GetSampler(const SamplerDescription &samplerDescription) const
+{
+    assert(objectCaches_ && samplerDescription.pNext == nullptr);
+
+    // all members behind pNext are 32 bit wide, so there is no padding
+    const auto *first = reinterpret_cast<const char*>(&samplerDescription.flags);
+    const auto *last = reinterpret_cast<const char*>(&samplerDescription.unnormalizedCoordinates + 1);
+    std::string key(first, last);
+
+    return GetOrCreate(objectCaches_->mutex, objectCaches_->samplers, std::move(key),
+                       [&]() { return CreateSampler(samplerDescription); });
+}
+
+const RenderPass& Device::GetRenderPass(const Span<AttachmentDescription> &attachments, const Span<SubpassDescription> &subpasses,
+                                        const Span<SubpassDependency> &dependencies, VkRenderPassCreateFlags flags) const
+{
+    assert(objectCaches_);
+
+    std::string key;
+    AppendBytes(key, flags);
+    AppendBytes(key, attachments.Count());
+    for (const auto &attachment : attachments)
+    {
+        AppendBytes(key, attachment);
+    }
+    AppendBytes(key, subpasses.Count());
+    for (const auto &subpass : subpasses)
+    {
+        AppendBytes(key, subpass.flags);
+        AppendBytes(key, subpass.pipelineBindPoint);
+        AppendArray(key, subpass.inputAttachments);
+        AppendArray(key, subpass.colorAttachments);
+        AppendArray(key, subpass.resolveAttachments);
+        AppendBytes(key, subpass.depthStencilAttachment);
+        AppendArray(key, subpass.preserveAttachments);
+    }
+    for (const auto &dependency : dependencies)
+    {
+        AppendBytes(key, dependency);
+    }
+
+    return GetOrCreate(objectCaches_->mutex, objectCaches_->renderPasses, std::move(key),
+                       [&]() { return CreateRenderPass(attachments, subpasses, dependencies, flags); });
+}
+
 DeviceMemory Device::AllocateMemory(VkDeviceSize allocationSize, uint32_t memoryTypeIndex) const
 {
     return AllocateMemoryExt(nullptr, allocationSize, memoryTypeIndex);
@@ -330,7 +488,12 @@ ShaderModule Device::CreateShaderModuleExt(const void *pNext, const Span<uint32_
     VkShaderModuleCreateInfo createInfo = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO, pNext, 0, code.Size(), code.Data()};
     VkShaderModule shaderModule;
     VK_CALL(vkCreateShaderModule(device_, &createInfo, nullptr, &shaderModule));
-    return ShaderModule(device_, shaderModule);
+    ShaderModule result(device_, shaderModule);
+    if (pipelineManifest_ != nullptr)
+    {
+        pipelineManifest_->RecordShaderModule(pNext, shaderModule, code);
+    }
+    return result;
 }
 
 ShaderModule Device::CreateShaderModule(const Span<char> &code) const
@@ -375,7 +538,62 @@ Pipeline Device::CreateComputePipelineExt(const void *pNext, const Pipeline::Sha
                                               flags, VkPipelineShaderStageCreateInfo(stage), VkPipelineLayout(layout), VkPipeline(basePipeline), -1};
     VkPipeline pipeline;
     VK_CALL(vkCreateComputePipelines(device_, VkPipelineCache(pipelineCache), 1, &createInfo, nullptr, &pipeline));
-    return Pipeline(device_, pipeline);
+    Pipeline result(device_, pipeline);
+    if (pipelineManifest_ != nullptr && pNext == nullptr && pipeline != VK_NULL_HANDLE)
+    {
+        pipelineManifest_->RecordComputePipeline(stage, layout, flags);
+    }
+    return result;
+}
+
+std::vector<Pipeline> Device::CreateComputePipelines(const Span<ComputePipelineDescription> &descriptions, const PipelineCache &pipelineCache) const
+{
+    assert(device_ && descriptions);
+
+    const auto count = descriptions.Count();
+    std::vector<VkComputePipelineCreateInfo> createInfos(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const auto &description = descriptions[i];
+        assert(description.stage.module && description.layout && description.basePipelineIndex < static_cast<int32_t>(i));
+
+        createInfos[i] = {VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO, nullptr, description.flags,
+                          VkPipelineShaderStageCreateInfo(description.stage), VkPipelineLayout(*description.layout),
+                          VK_NULL_HANDLE, description.basePipelineIndex};
+        if (description.basePipelineIndex >= 0)
+        {
+            createInfos[i].flags |= VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+            createInfos[description.basePipelineIndex].flags |= VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
+        }
+    }
+
+    std::vector<VkPipeline> vkPipelines(count, VK_NULL_HANDLE);
+    const auto result = vkCreateComputePipelines(device_, VkPipelineCache(pipelineCache), count, createInfos.data(), nullptr, vkPipelines.data());
+
+    // pipelines which have been created before the error are destroyed by their wrappers
+    std::vector<Pipeline> pipelines;
+    pipelines.reserve(count);
+    for (auto pipeline : vkPipelines)
+    {
+        pipelines.emplace_back(device_, pipeline);
+    }
+    if (result < VK_SUCCESS)
+    {
+        throw Exception(result);
+    }
+    if (pipelineManifest_ != nullptr)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            // skipped by VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT
+            if (vkPipelines[i] != VK_NULL_HANDLE)
+            {
+                const auto &description = descriptions[i];
+                pipelineManifest_->RecordComputePipeline(description.stage, *description.layout, description.flags);
+            }
+        }
+    }
+    return pipelines;
 }
 
 VkResult Device::WaitForFences(const Span2<Fence> &fences, uint64_t timeoutInNanoSeconds, bool waitAll) const
@@ -395,6 +613,95 @@ VkResult Device::WaitForFences(const Span2<Fence> &fences, uint64_t timeoutInNan
     return result;
 }
 
+VkResult Device::WaitForFences(const Span2<Fence> &fences, const WaitStrategy &strategy, uint64_t timeoutInNanoSeconds, bool waitAll) const
+{
+    assert(device_);
+
+    const uint32_t fenceCount = fences.Count();
+    if (fenceCount == 0)
+    {
+        return VK_SUCCESS;
+    }
+
+    auto pFences = static_cast<VkFence*>(alloca(sizeof(VkFence) * fenceCount));
+    fences.Emplace(pFences);
+
+    // signaled fences are moved behind the still unsignaled ones, so they are not polled again
+    uint32_t unsignaledCount = fenceCount;
+    auto poll = [&]()
+    {
+        for (uint32_t i = 0; i < unsignaledCount;)
+        {
+            auto result = vkGetFenceStatus(device_, pFences[i]);
+            VK_CALL(result);
+            if (result == VK_SUCCESS)
+            {
+                if (!waitAll)
+                {
+                    return true;
+                }
+                std::swap(pFences[i], pFences[--unsignaledCount]);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        return unsignaledCount == 0;
+    };
+
+    if (SpinWait(strategy, timeoutInNanoSeconds, poll))
+    {
+        return VK_SUCCESS;
+    }
+
+    auto result = vkWaitForFences(device_, unsignaledCount, pFences, static_cast<VkBool32>(waitAll), timeoutInNanoSeconds);
+    VK_CALL(result);
+    return result;
+}
+
+std::vector<uint32_t> Device::WaitForAnyFence(const Span2<Fence> &fences, uint64_t timeoutInNanoSeconds, const WaitStrategy &strategy) const
+{
+    assert(device_);
+
+    std::vector<uint32_t> signaledIndices;
+    const uint32_t fenceCount = fences.Count();
+    if (fenceCount == 0)
+    {
+        return signaledIndices;
+    }
+
+    auto pFences = static_cast<VkFence*>(alloca(sizeof(VkFence) * fenceCount));
+    fences.Emplace(pFences);
+
+    auto collect = [&]()
+    {
+        for (uint32_t i = 0; i < fenceCount; ++i)
+        {
+            auto result = vkGetFenceStatus(device_, pFences[i]);
+            VK_CALL(result);
+            if (result == VK_SUCCESS)
+            {
+                signaledIndices.push_back(i);
+            }
+        }
+        return !signaledIndices.empty();
+    };
+
+    if (SpinWait(strategy, timeoutInNanoSeconds, collect))
+    {
+        return signaledIndices;
+    }
+
+    auto result = vkWaitForFences(device_, fenceCount, pFences, VK_FALSE, timeoutInNanoSeconds);
+    VK_CALL(result);
+    if (result == VK_SUCCESS)
+    {
+        collect();
+    }
+    return signaledIndices;
+}
+
 void Device::ResetFences(const Span2<Fence> &fences) const
 {
     assert(device_);
@@ -422,7 +729,27 @@ DescriptorSetLayout Device::CreateDescriptorSetLayoutExt(const void *pNext, cons
     VkDescriptorSetLayoutCreateInfo createInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO, pNext, flags, bindings.Count(), bindings.Data()};
     VkDescriptorSetLayout setLayout;
     VK_CALL(vkCreateDescriptorSetLayout(device_, &createInfo, nullptr, &setLayout));
-    return DescriptorSetLayout(device_, setLayout);
+    DescriptorSetLayout result(device_, setLayout);
+    if (pipelineManifest_ != nullptr)
+    {
+        pipelineManifest_->RecordDescriptorSetLayout(pNext, setLayout, bindings, {}, flags);
+    }
+    return result;
+}
+
+DescriptorSetLayout Device::CreateDescriptorSetLayout(const Span<VkDescriptorSetLayoutBinding> &bindings, const Span<VkDescriptorBindingFlags> &bindingFlags,
+                                                  VkDescriptorSetLayoutCreateFlags flags) const
+{
+    assert(bindings.Count() == bindingFlags.Count());
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO, nullptr,
+                                                                    bindingFlags.Count(), bindingFlags.Data()};
+    auto setLayout = CreateDescriptorSetLayoutExt(&bindingFlagsInfo, bindings, flags);
+    if (pipelineManifest_ != nullptr)
+    {
+        pipelineManifest_->RecordDescriptorSetLayout(nullptr, VkDescriptorSetLayout(setLayout), bindings, bindingFlags, flags);
+    }
+    return setLayout;
 }
 
 PipelineLayout Device::CreatePipelineLayout(const Span2<DescriptorSetLayout> &setLayouts, const Span<VkPushConstantRange> &pushConstantRanges, VkPipelineLayoutCreateFlags flags) const
@@ -446,7 +773,12 @@ PipelineLayout Device::CreatePipelineLayoutExt(const void *pNext, const Span2<De
                                              pushConstantRanges.Count(), pushConstantRanges.Data()};
     VkPipelineLayout pipelineLayout;
     VK_CALL(vkCreatePipelineLayout(device_, &createInfo, nullptr, &pipelineLayout));
-    return PipelineLayout(device_, pipelineLayout);
+    PipelineLayout result(device_, pipelineLayout);
+    if (pipelineManifest_ != nullptr)
+    {
+        pipelineManifest_->RecordPipelineLayout(pNext, pipelineLayout, setLayouts, pushConstantRanges, flags);
+    }
+    return result;
 }
 
 DescriptorPool Device::CreateDescriptorPool(uint32_t maxSets, const Span<VkDescriptorPoolSize> &poolSizes, VkDescriptorPoolCreateFlags flags) const
@@ -547,6 +879,56 @@ void Device::UpdateDescriptorSetExt(const void *pNext, const DescriptorSet &srcS
     vkUpdateDescriptorSets(device_, 0, nullptr, 1, &copy);
 }
 
+DescriptorUpdateTemplate Device::CreateDescriptorUpdateTemplate(const Span<VkDescriptorUpdateTemplateEntry> &entries, const DescriptorSetLayout &setLayout,
+                                                                VkDescriptorUpdateTemplateCreateFlags flags) const
+{
+    return CreateDescriptorUpdateTemplateExt(nullptr, entries, setLayout, flags);
+}
+
+DescriptorUpdateTemplate Device::CreateDescriptorUpdateTemplateExt(const void *pNext, const Span<VkDescriptorUpdateTemplateEntry> &entries,
+                                                                   const DescriptorSetLayout &setLayout, VkDescriptorUpdateTemplateCreateFlags flags) const
+{
+    assert(device_ && entries && setLayout);
+
+    VkDescriptorUpdateTemplateCreateInfo createInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO, pNext, flags, entries.Count(), entries.Data(),
+                                                       VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET, VkDescriptorSetLayout(setLayout),
+                                                       VK_PIPELINE_BIND_POINT_GRAPHICS, VK_NULL_HANDLE, 0};
+
+    VkDescriptorUpdateTemplate updateTemplate;
+    VK_CALL(vkCreateDescriptorUpdateTemplate(device_, &createInfo, nullptr, &updateTemplate));
+    return DescriptorUpdateTemplate(device_, updateTemplate);
+}
+
+void Device::UpdateDescriptorSetWithTemplate(const DescriptorSet &dstSet, const DescriptorUpdateTemplate &updateTemplate, const void *pData) const
+{
+    assert(device_ && dstSet && updateTemplate && pData);
+    vkUpdateDescriptorSetWithTemplate(device_, VkDescriptorSet(dstSet), VkDescriptorUpdateTemplate(updateTemplate), pData);
+}
+
+DescriptorUpdateTemplate Device::CreatePushDescriptorUpdateTemplate(const Span<VkDescriptorUpdateTemplateEntry> &entries, VkPipelineBindPoint pipelineBindPoint,
+                                                                    const PipelineLayout &layout, uint32_t set, VkDescriptorUpdateTemplateCreateFlags flags) const
+{
+    assert(device_ && entries && layout);
+
+    VkDescriptorUpdateTemplateCreateInfo createInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO, nullptr, flags, entries.Count(), entries.Data(),
+                                                       VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR, VK_NULL_HANDLE,
+                                                       pipelineBindPoint, VkPipelineLayout(layout), set};
+
+    VkDescriptorUpdateTemplate updateTemplate;
+    VK_CALL(vkCreateDescriptorUpdateTemplate(device_, &createInfo, nullptr, &updateTemplate));
+    return DescriptorUpdateTemplate(device_, updateTemplate);
+}
+
+void Device::UpdateInlineUniformBlock(const DescriptorSet &dstSet, uint32_t dstBinding, uint32_t dstByteOffset, const void *pData, uint32_t dataSize) const
+{
+    assert(device_ && dstSet && pData && dataSize > 0);
+
+    VkWriteDescriptorSetInlineUniformBlockEXT inlineUniformBlock = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_INLINE_UNIFORM_BLOCK_EXT, nullptr, dataSize, pData};
+    VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, &inlineUniformBlock, VkDescriptorSet(dstSet), dstBinding, dstByteOffset, dataSize,
+                                  VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT, nullptr, nullptr, nullptr};
+    vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+}
+
 RenderPass Device::CreateRenderPass(const Span<AttachmentDescription> &attachments, const Span<SubpassDescription> &subpasses,
                                     const Span<SubpassDependency> &dependencies, VkRenderPassCreateFlags flags) const
 {
@@ -569,7 +951,12 @@ RenderPass Device::CreateRenderPassExt(const void *pNext, const Span<AttachmentD
 
     VkRenderPass renderPass;
     VK_CALL(vkCreateRenderPass(device_, &createInfo, nullptr, &renderPass));
-    return RenderPass(device_, renderPass);
+    RenderPass result(device_, renderPass);
+    if (pipelineManifest_ != nullptr)
+    {
+        pipelineManifest_->RecordRenderPass(pNext, renderPass, attachments, subpasses, dependencies, flags);
+    }
+    return result;
 }
 
 Framebuffer Device::CreateFramebuffer(const RenderPass &renderPass, uint32_t width, uint32_t height, const Span2<ImageView> &attachments,
@@ -656,6 +1043,186 @@ Pipeline Device::CreateGraphicsPipelineExt(const void *pNext, const RenderPass &
                                                reinterpret_cast<const VkPipelineDepthStencilStateCreateInfo*>(gfxPipeDesc.depthStencilState),
                                                pColorBlendState, pDynamicState, VkPipelineLayout(layout), VkRenderPass(renderPass), subpass, VkPipeline(basePipeline), -1};
 
+    VkPipeline pipeline;
+    VK_CALL(vkCreateGraphicsPipelines(device_, VkPipelineCache(pipelineCache), 1, &createInfo, nullptr, &pipeline));
+    Pipeline result(device_, pipeline);
+    if (pipelineManifest_ != nullptr && pNext == nullptr && pipeline != VK_NULL_HANDLE)
+    {
+        pipelineManifest_->RecordGraphicsPipeline(renderPass, subpass, stages, layout, gfxPipeDesc, flags);
+    }
+    return result;
+}
+
+std::vector<Pipeline> Device::CreateGraphicsPipelines(const Span<GraphicsPipelineDescription> &descriptions, const PipelineCache &pipelineCache) const
+{
+    assert(device_ && descriptions);
+
+    const auto count = descriptions.Count();
+    size_t stageCount = 0;
+    for (const auto &description : descriptions)
+    {
+        stageCount += description.stages.size();
+    }
+
+    std::vector<VkPipelineShaderStageCreateInfo> stages;
+    stages.reserve(stageCount);
+    std::vector<VkPipelineVertexInputStateCreateInfo> vertexInputStates(count);
+    std::vector<VkPipelineViewportStateCreateInfo> viewportStates(count);
+    std::vector<VkPipelineColorBlendStateCreateInfo> colorBlendStates(count);
+    std::vector<VkPipelineDynamicStateCreateInfo> dynamicStates(count);
+    std::vector<VkGraphicsPipelineCreateInfo> createInfos(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const auto &description = descriptions[i];
+        const auto &state = description.state;
+        assert(description.renderPass && *description.renderPass && !description.stages.empty() && description.layout && *description.layout);
+        assert(description.basePipelineIndex < static_cast<int32_t>(i));
+
+        const auto pStages = stages.data() + stages.size();
+        for (const auto &stage : description.stages)
+        {
+            stages.push_back(VkPipelineShaderStageCreateInfo(stage));
+        }
+
+        vertexInputStates[i] = VkPipelineVertexInputStateCreateInfo(state.vertexInputState);
+        if (state.viewportState != nullptr)
+        {
+            viewportStates[i] = VkPipelineViewportStateCreateInfo(*state.viewportState);
+        }
+        if (state.colorBlendState != nullptr)
+        {
+            colorBlendStates[i] = VkPipelineColorBlendStateCreateInfo(*state.colorBlendState);
+        }
+        if (state.dynamicState != nullptr)
+        {
+            dynamicStates[i] = VkPipelineDynamicStateCreateInfo(*state.dynamicState);
+        }
+
+        createInfos[i] = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO, nullptr, description.flags,
+                          static_cast<uint32_t>(description.stages.size()), pStages, &vertexInputStates[i],
+                          reinterpret_cast<const VkPipelineInputAssemblyStateCreateInfo*>(&state.inputAssemblyState),
+                          reinterpret_cast<const VkPipelineTessellationStateCreateInfo*>(state.tessellationState),
+                          state.viewportState != nullptr ? &viewportStates[i] : nullptr,
+                          reinterpret_cast<const VkPipelineRasterizationStateCreateInfo*>(&state.rasterizationState),
+                          reinterpret_cast<const VkPipelineMultisampleStateCreateInfo*>(state.multisampleState),
+                          reinterpret_cast<const VkPipelineDepthStencilStateCreateInfo*>(state.depthStencilState),
+                          state.colorBlendState != nullptr ? &colorBlendStates[i] : nullptr,
+                          state.dynamicState != nullptr ? &dynamicStates[i] : nullptr,
+                          VkPipelineLayout(*description.layout), VkRenderPass(*description.renderPass), description.subpass,
+                          VK_NULL_HANDLE, description.basePipelineIndex};
+        if (description.basePipelineIndex >= 0)
+        {
+            createInfos[i].flags |= VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+            createInfos[description.basePipelineIndex].flags |= VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
+        }
+    }
+
+    std::vector<VkPipeline> vkPipelines(count, VK_NULL_HANDLE);
+    const auto result = vkCreateGraphicsPipelines(device_, VkPipelineCache(pipelineCache), count, createInfos.data(), nullptr, vkPipelines.data());
+
+    // pipelines which have been created before the error are destroyed by their wrappers
+    std::vector<Pipeline> pipelines;
+    pipelines.reserve(count);
+    for (auto pipeline : vkPipelines)
+    {
+        pipelines.emplace_back(device_, pipeline);
+    }
+    if (result < VK_SUCCESS)
+    {
+        throw Exception(result);
+    }
+    if (pipelineManifest_ != nullptr)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            // skipped by VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT
+            if (vkPipelines[i] != VK_NULL_HANDLE)
+            {
+                const auto &description = descriptions[i];
+                pipelineManifest_->RecordGraphicsPipeline(*description.renderPass, description.subpass, description.stages,
+                                                          *description.layout, description.state, description.flags);
+            }
+        }
+    }
+    return pipelines;
+}
+
+Pipeline Device::CreateGraphicsPipelineLibrary(VkGraphicsPipelineLibraryFlagsEXT parts, const GraphicsPipelineDescription &description,
+                                               const PipelineCache &pipelineCache) const
+{
+    const bool vertexInput = (parts & VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT) != 0;
+    const bool preRasterization = (parts & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT) != 0;
+    const bool fragmentShader = (parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT) != 0;
+    const bool fragmentOutput = (parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT) != 0;
+    assert(device_ && parts != 0 && description.basePipelineIndex < 0);
+    assert(description.renderPass || !(preRasterization || fragmentShader || fragmentOutput));
+    assert(description.layout || !(preRasterization || fragmentShader));
+
+    const auto &state = description.state;
+
+    // the fragment stage belongs to the fragment shader part, all other stages to the pre-rasterization part
+    std::vector<VkPipelineShaderStageCreateInfo> stages;
+    for (const auto &stage : description.stages)
+    {
+        if (stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT ? fragmentShader : preRasterization)
+        {
+            stages.push_back(VkPipelineShaderStageCreateInfo(stage));
+        }
+    }
+
+    const auto vertexInputState = VkPipelineVertexInputStateCreateInfo(state.vertexInputState);
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    if (state.viewportState != nullptr)
+    {
+        viewportState = VkPipelineViewportStateCreateInfo(*state.viewportState);
+    }
+    VkPipelineColorBlendStateCreateInfo colorBlendState = {};
+    if (state.colorBlendState != nullptr)
+    {
+        colorBlendState = VkPipelineColorBlendStateCreateInfo(*state.colorBlendState);
+    }
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    if (state.dynamicState != nullptr)
+    {
+        dynamicState = VkPipelineDynamicStateCreateInfo(*state.dynamicState);
+    }
+
+    const VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT, nullptr, parts};
+    const VkGraphicsPipelineCreateInfo createInfo = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO, &libraryInfo, description.flags | VK_PIPELINE_CREATE_LIBRARY_BIT_KHR,
+        static_cast<uint32_t>(stages.size()), stages.empty() ? nullptr : stages.data(),
+        vertexInput ? &vertexInputState : nullptr,
+        vertexInput ? reinterpret_cast<const VkPipelineInputAssemblyStateCreateInfo*>(&state.inputAssemblyState) : nullptr,
+        preRasterization ? reinterpret_cast<const VkPipelineTessellationStateCreateInfo*>(state.tessellationState) : nullptr,
+        preRasterization && state.viewportState != nullptr ? &viewportState : nullptr,
+        preRasterization ? reinterpret_cast<const VkPipelineRasterizationStateCreateInfo*>(&state.rasterizationState) : nullptr,
+        fragmentShader || fragmentOutput ? reinterpret_cast<const VkPipelineMultisampleStateCreateInfo*>(state.multisampleState) : nullptr,
+        fragmentShader ? reinterpret_cast<const VkPipelineDepthStencilStateCreateInfo*>(state.depthStencilState) : nullptr,
+        fragmentOutput && state.colorBlendState != nullptr ? &colorBlendState : nullptr,
+        state.dynamicState != nullptr ? &dynamicState : nullptr,
+        preRasterization || fragmentShader ? VkPipelineLayout(*description.layout) : VK_NULL_HANDLE,
+        preRasterization || fragmentShader || fragmentOutput ? VkRenderPass(*description.renderPass) : VK_NULL_HANDLE,
+        description.subpass, VK_NULL_HANDLE, -1};
+
+    VkPipeline pipeline;
+    VK_CALL(vkCreateGraphicsPipelines(device_, VkPipelineCache(pipelineCache), 1, &createInfo, nullptr, &pipeline));
+    return Pipeline(device_, pipeline);
+}
+
+Pipeline Device::LinkGraphicsPipelineLibraries(const Span2<Pipeline> &libraries, const PipelineLayout &layout, const PipelineCache &pipelineCache,
+                                               VkPipelineCreateFlags flags) const
+{
+    assert(device_ && libraries && layout);
+
+    const auto libraryCount = libraries.Count();
+    auto pLibraries = static_cast<VkPipeline*>(alloca(sizeof(VkPipeline) * libraryCount));
+    libraries.Emplace(pLibraries);
+
+    // the state comes from the libraries
+    const VkPipelineLibraryCreateInfoKHR libraryInfo = {VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR, nullptr, libraryCount, pLibraries};
+    const VkGraphicsPipelineCreateInfo createInfo = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO, &libraryInfo, flags, 0, nullptr,
+                                                     nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+                                                     VkPipelineLayout(layout), VK_NULL_HANDLE, 0, VK_NULL_HANDLE, -1};
+
     VkPipeline pipeline;
     VK_CALL(vkCreateGraphicsPipelines(device_, VkPipelineCache(pipelineCache), 1, &createInfo, nullptr, &pipeline));
     return Pipeline(device_, pipeline);
@@ -23,6 +23,7 @@ SOFTWARE.
 #include "VulkanWrapper.h"
 
 #include "Error.h"
+#include "SpinWait.h"
 
 namespace vkw
 {
@@ -42,6 +43,16 @@ VkResult Fence::Wait(uint64_t timeoutInNanoSeconds) const
     return res;
 }
 
+VkResult Fence::Wait(const WaitStrategy &strategy, uint64_t timeoutInNanoSeconds) const
+{
+    assert(fence_);
+    if (SpinWait(strategy, timeoutInNanoSeconds, [this]() { return GetStatus() == VK_SUCCESS; }))
+    {
+        return VK_SUCCESS;
+    }
+    return Wait(timeoutInNanoSeconds);
+}
+
 void Fence::Reset() const
 {
     assert(fence_);
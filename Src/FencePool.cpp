@@ -0,0 +1,131 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include "Error.h"
+
+namespace vkw
+{
+
+namespace
+{
+
+Fence CreatePooledFence(VkDevice device)
+{
+    VkFenceCreateInfo createInfo = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    VkFence fence;
+    VK_CALL(vkCreateFence(device, &createInfo, nullptr, &fence));
+    return Fence(device, fence);
+}
+
+} // namespace
+
+FencePool::FencePool(const Device &device, uint32_t initialFenceCount)
+    : device_(VkDevice(device))
+{
+    assert(device_);
+    free_.reserve(initialFenceCount);
+    for (uint32_t i = 0; i < initialFenceCount; ++i)
+    {
+        free_.emplace_back(CreatePooledFence(device_));
+    }
+}
+
+Fence FencePool::Acquire()
+{
+    assert(device_);
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (free_.empty())
+    {
+        RecycleLocked();
+    }
+
+    if (free_.empty())
+    {
+        return CreatePooledFence(device_);
+    }
+
+    auto fence = std::move(free_.back());
+    free_.pop_back();
+    return fence;
+}
+
+void FencePool::Release(Fence &&fence, bool pending)
+{
+    assert(fence);
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (pending)
+    {
+        pending_.emplace_back(std::move(fence));
+    }
+    else
+    {
+        free_.emplace_back(std::move(fence));
+    }
+}
+
+void FencePool::Recycle()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    RecycleLocked();
+}
+
+void FencePool::RecycleLocked()
+{
+    for (size_t i = 0; i < pending_.size();)
+    {
+        if (pending_[i].GetStatus() == VK_SUCCESS)
+        {
+            signaled_.emplace_back(std::move(pending_[i]));
+            pending_[i] = std::move(pending_.back());
+            pending_.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    if (signaled_.empty())
+    {
+        return;
+    }
+
+    std::vector<VkFence> fences;
+    fences.reserve(signaled_.size());
+    for (const auto &fence : signaled_)
+    {
+        fences.push_back(VkFence(fence));
+    }
+    VK_CALL(vkResetFences(device_, static_cast<uint32_t>(fences.size()), fences.data()));
+
+    for (auto &fence : signaled_)
+    {
+        free_.emplace_back(std::move(fence));
+    }
+    signaled_.clear();
+}
+
+} // namespace vkw
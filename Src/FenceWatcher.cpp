@@ -0,0 +1,145 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include <iterator>
+
+#include "Error.h"
+
+namespace vkw
+{
+
+FenceWatcher::FenceWatcher(const Device &device, Executor executor, uint64_t pollIntervalInNanoSeconds)
+    : device_(VkDevice(device))
+    , executor_(std::move(executor))
+    , pollIntervalInNanoSeconds_(pollIntervalInNanoSeconds)
+{
+    assert(device);
+    thread_ = std::thread(&FenceWatcher::Run, this);
+}
+
+FenceWatcher::~FenceWatcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+void FenceWatcher::Watch(const Fence &fence, Callback callback)
+{
+    Watch(VkFence(fence), std::move(callback));
+}
+
+void FenceWatcher::Watch(VkFence fence, Callback &&callback)
+{
+    assert(fence != VK_NULL_HANDLE && callback);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        incomingFences_.push_back(fence);
+        incomingCallbacks_.emplace_back(std::move(callback));
+    }
+    cv_.notify_one();
+}
+
+void FenceWatcher::Run()
+{
+    std::vector<VkFence> fences;
+    std::vector<Callback> callbacks;
+    std::vector<Callback> completed;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (fences.empty())
+            {
+                cv_.wait(lock, [this] { return stop_ || !incomingFences_.empty(); });
+            }
+            if (stop_)
+            {
+                break;
+            }
+
+            fences.insert(fences.end(), incomingFences_.begin(), incomingFences_.end());
+            callbacks.insert(callbacks.end(), std::make_move_iterator(incomingCallbacks_.begin()), std::make_move_iterator(incomingCallbacks_.end()));
+            incomingFences_.clear();
+            incomingCallbacks_.clear();
+        }
+
+        auto result = result_.load();
+        if (result == VK_SUCCESS)
+        {
+            result = vkWaitForFences(device_, static_cast<uint32_t>(fences.size()), fences.data(), VK_FALSE, pollIntervalInNanoSeconds_);
+        }
+
+        if (result == VK_TIMEOUT)
+        {
+            continue;
+        }
+
+        // keep the order of the remaining fences, so callbacks fire in watch order within one wake up
+        size_t remaining = 0;
+        for (size_t i = 0; i < fences.size(); ++i)
+        {
+            VkResult status = result;
+            if (result == VK_SUCCESS)
+            {
+                status = vkGetFenceStatus(device_, fences[i]);
+            }
+
+            if (status == VK_NOT_READY)
+            {
+                fences[remaining] = fences[i];
+                callbacks[remaining] = std::move(callbacks[i]);
+                ++remaining;
+                continue;
+            }
+
+            if (status < VK_SUCCESS)
+            {
+                result_.store(status);
+            }
+            completed.emplace_back(std::move(callbacks[i]));
+        }
+        fences.resize(remaining);
+        callbacks.resize(remaining);
+
+        for (auto &callback : completed)
+        {
+            if (executor_)
+            {
+                executor_(std::move(callback));
+            }
+            else
+            {
+                callback();
+            }
+        }
+        completed.clear();
+    }
+}
+
+} // namespace vkw
@@ -0,0 +1,148 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include "Error.h"
+
+namespace vkw
+{
+
+FrameContext::FrameContext(const Device &device, uint32_t frameCount, uint32_t queueFamilyIndex, VkDeviceSize ringSliceSize,
+                           uint32_t maxDescriptorSets, const Span<VkDescriptorPoolSize> &descriptorPoolSizes,
+                           VkCommandPoolCreateFlags commandPoolFlags)
+    : frames_(frameCount)
+{
+    assert(device && frameCount > 0);
+
+    VkDeviceSize ringOffset = 0;
+    for (auto &frame : frames_)
+    {
+        // created signaled so that the first BeginFrame of every frame does not block
+        frame.fence = device.CreateFence(VK_FENCE_CREATE_SIGNALED_BIT);
+        frame.commandPool = device.CreateCommandPool(queueFamilyIndex, commandPoolFlags);
+        frame.commandBuffer = frame.commandPool.AllocateCommandBuffer();
+        if (maxDescriptorSets > 0)
+        {
+            frame.descriptorPool = device.CreateDescriptorPool(maxDescriptorSets, descriptorPoolSizes);
+        }
+        frame.ringOffset = ringOffset;
+        frame.ringSize = ringSliceSize;
+        ringOffset += ringSliceSize;
+    }
+}
+
+FrameContext::Frame& FrameContext::BeginFrame(uint64_t timeoutInNanoSeconds)
+{
+    assert(!frames_.empty());
+
+    // the frame only becomes current once its fence has been signaled, so a timeout can be retried
+    const auto frameIndex = static_cast<uint32_t>(frameNumber_ % frames_.size());
+    auto &frame = frames_[frameIndex];
+    if (frame.fence.Wait(timeoutInNanoSeconds) == VK_TIMEOUT)
+    {
+        throw Exception(VK_TIMEOUT);
+    }
+    frameIndex_ = frameIndex;
+    ++frameNumber_;
+    // the fence is reset by GetSubmitFence, a frame which is never submitted keeps it signaled
+    fenceReset_ = false;
+
+    frame.commandPool.Reset();
+    if (frame.descriptorPool)
+    {
+        frame.descriptorPool.Reset();
+    }
+    frame.ringHead = 0;
+    frame.deferredDeletions.clear();
+
+    return frame;
+}
+
+const Fence& FrameContext::GetSubmitFence()
+{
+    auto &frame = GetCurrentFrame();
+    if (!fenceReset_)
+    {
+        frame.fence.Reset();
+        fenceReset_ = true;
+    }
+    return frame.fence;
+}
+
+void FrameContext::WaitIdle()
+{
+    for (auto &frame : frames_)
+    {
+        frame.fence.Wait();
+        frame.deferredDeletions.clear();
+    }
+}
+
+FrameContext::Frame& FrameContext::GetCurrentFrame()
+{
+    assert(!frames_.empty());
+    return frames_[frameIndex_];
+}
+
+const FrameContext::Frame& FrameContext::GetCurrentFrame() const
+{
+    assert(!frames_.empty());
+    return frames_[frameIndex_];
+}
+
+uint32_t FrameContext::GetFrameIndex() const
+{
+    return frameIndex_;
+}
+
+uint64_t FrameContext::GetFrameNumber() const
+{
+    return frameNumber_;
+}
+
+uint32_t FrameContext::GetFrameCount() const
+{
+    return static_cast<uint32_t>(frames_.size());
+}
+
+std::optional<VkDeviceSize> FrameContext::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    assert(alignment > 0);
+
+    auto &frame = GetCurrentFrame();
+    auto offset = frame.ringOffset + frame.ringHead;
+    if (offset % alignment != 0)
+    {
+        offset = offset + alignment - offset % alignment;
+    }
+
+    if (offset + size > frame.ringOffset + frame.ringSize)
+    {
+        return {};
+    }
+
+    frame.ringHead = offset + size - frame.ringOffset;
+    return offset;
+}
+
+} // namespace vkw
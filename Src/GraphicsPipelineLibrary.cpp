@@ -0,0 +1,169 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include "Error.h"
+
+namespace vkw
+{
+
+namespace
+{
+
+constexpr std::array<VkGraphicsPipelineLibraryFlagBitsEXT, 4> PARTS = {VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+                                                                       VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+                                                                       VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+                                                                       VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT};
+
+const PipelineCache& GetPipelineCache(const PipelineCache *pPipelineCache)
+{
+    static const PipelineCache noPipelineCache;
+    return pPipelineCache != nullptr ? *pPipelineCache : noPipelineCache;
+}
+
+template <typename T>
+T& FindOrInsert(std::shared_mutex &mutex, std::unordered_map<PipelineKey, std::unique_ptr<T>, PipelineKey::Hash> &objects, PipelineKey &&key)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        const auto it = objects.find(key);
+        if (it != objects.end())
+        {
+            return *it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto &object = objects[std::move(key)];
+    if (!object)
+    {
+        object = std::make_unique<T>();
+    }
+    return *object;
+}
+
+} // namespace
+
+GraphicsPipelineLibrary::GraphicsPipelineLibrary(const Device &device, PipelineCompiler *compiler, const PipelineCache &pipelineCache)
+    : device_(std::make_shared<const Device>(device.GetView()))
+    , compiler_(compiler)
+    , pipelineCache_(pipelineCache ? &pipelineCache : nullptr)
+{
+    assert(device);
+}
+
+GraphicsPipelineLibrary::~GraphicsPipelineLibrary()
+{
+    // the optimized links use the cached parts
+    for (auto &entry : entries_)
+    {
+        if (entry.second->pending.load())
+        {
+            entry.second->future.wait();
+        }
+    }
+}
+
+const Pipeline& GraphicsPipelineLibrary::Get(const GraphicsPipelineDescription &description)
+{
+    assert(description.renderPass && description.layout && description.basePipelineIndex < 0);
+
+    auto &entry = FindOrInsert(mutex_, entries_, PipelineKey(description));
+
+    // linking happens outside of the lock, requests for the same pipeline wait here
+    std::call_once(entry.linked, [&]()
+    {
+        Link(description, entry);
+    });
+
+    if (entry.pending.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lock(entry.mutex);
+        if (entry.pending.load(std::memory_order_relaxed) &&
+            entry.future.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            try
+            {
+                entry.optimizedPipeline = entry.future.get();
+                entry.optimized.store(true, std::memory_order_release);
+            }
+            catch (const Exception&)
+            {
+                // the fast linked pipeline stays in use
+            }
+            entry.pending.store(false, std::memory_order_relaxed);
+            --pendingCount_;
+        }
+    }
+
+    return entry.optimized.load(std::memory_order_acquire) ? entry.optimizedPipeline : entry.pipeline;
+}
+
+size_t GraphicsPipelineLibrary::GetPartCount() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return parts_.size();
+}
+
+const Pipeline& GraphicsPipelineLibrary::GetPart(VkGraphicsPipelineLibraryFlagBitsEXT part, const GraphicsPipelineDescription &description)
+{
+    auto &entry = FindOrInsert(mutex_, parts_, PipelineKey(description, part));
+
+    std::call_once(entry.created, [&]()
+    {
+        entry.library = device_->CreateGraphicsPipelineLibrary(part, description, GetPipelineCache(pipelineCache_));
+    });
+    return entry.library;
+}
+
+void GraphicsPipelineLibrary::Link(const GraphicsPipelineDescription &description, Entry &entry)
+{
+    // the optimized link needs the intermediate information of the libraries
+    auto libraryDescription = description;
+    if (compiler_ != nullptr)
+    {
+        libraryDescription.flags |= VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+    }
+
+    std::array<const Pipeline*, PARTS.size()> libraries;
+    for (size_t i = 0; i < PARTS.size(); ++i)
+    {
+        libraries[i] = &GetPart(PARTS[i], libraryDescription);
+    }
+
+    entry.pipeline = device_->LinkGraphicsPipelineLibraries(libraries, *description.layout, GetPipelineCache(pipelineCache_), description.flags);
+
+    if (compiler_ != nullptr)
+    {
+        const auto layout = description.layout;
+        const auto flags = description.flags | VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT;
+        entry.future = compiler_->Submit([libraries, layout, flags](const Device &device, const PipelineCache &pipelineCache)
+        {
+            return device.LinkGraphicsPipelineLibraries(libraries, *layout, pipelineCache, flags);
+        });
+        ++pendingCount_;
+        entry.pending.store(true, std::memory_order_release);
+    }
+}
+
+} // namespace vkw
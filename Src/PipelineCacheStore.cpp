@@ -0,0 +1,279 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#if _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "Error.h"
+#include "MappedFile.h"
+#include "Serialization.h"
+
+namespace vkw
+{
+
+namespace
+{
+
+constexpr uint32_t FILE_MAGIC = 0x43505756; // "VWPC"
+constexpr uint32_t FILE_VERSION = 1;
+constexpr uint32_t FILE_FLAG_COMPRESSED = 0x1;
+
+struct FileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t checksum;
+    uint64_t dataSize;
+    uint64_t uncompressedSize;
+};
+
+uint32_t Checksum(const char *pData, size_t dataSize)
+{
+    return static_cast<uint32_t>(Fnv1a(pData, dataSize));
+}
+
+bool IsCompatible(const char *pData, size_t dataSize, const VkPhysicalDeviceProperties &properties)
+{
+    VkPipelineCacheHeaderVersionOne header;
+    if (dataSize < sizeof(header))
+    {
+        return false;
+    }
+    memcpy(&header, pData, sizeof(header));
+
+    return header.headerSize >= sizeof(header) && header.headerSize <= dataSize &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == properties.vendorID &&
+           header.deviceID == properties.deviceID &&
+           memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+// the contents are flushed to the disk before the function returns, so the file can be renamed over the previous one
+bool WriteFileDurably(const std::string &path, const FileHeader &header, const char *pData)
+{
+#if _WIN32
+    const HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    const auto write = [file](const char *pBytes, uint64_t size)
+    {
+        while (size > 0)
+        {
+            DWORD written = 0;
+            const auto chunk = static_cast<DWORD>(std::min<uint64_t>(size, UINT32_MAX));
+            if (!WriteFile(file, pBytes, chunk, &written, nullptr) || written == 0)
+            {
+                return false;
+            }
+            pBytes += written;
+            size -= written;
+        }
+        return true;
+    };
+
+    const auto result = write(reinterpret_cast<const char*>(&header), sizeof(header)) && write(pData, header.dataSize) && FlushFileBuffers(file);
+    return CloseHandle(file) && result;
+#else
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    const auto write = [fd](const char *pBytes, uint64_t size)
+    {
+        while (size > 0)
+        {
+            const auto written = ::write(fd, pBytes, static_cast<size_t>(size));
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (written <= 0)
+            {
+                return false;
+            }
+            pBytes += written;
+            size -= static_cast<uint64_t>(written);
+        }
+        return true;
+    };
+
+    const auto result = write(reinterpret_cast<const char*>(&header), sizeof(header)) && write(pData, header.dataSize) && fsync(fd) == 0;
+    return close(fd) == 0 && result;
+#endif
+}
+
+bool ReplaceFile(const std::string &from, const std::string &to)
+{
+#if _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (std::rename(from.c_str(), to.c_str()) != 0)
+    {
+        return false;
+    }
+
+    // the rename itself only survives a crash once the directory has been flushed, some file systems do not support that
+    const auto separator = to.find_last_of('/');
+    const auto directory = separator == std::string::npos ? std::string(".") : separator == 0 ? std::string("/") : to.substr(0, separator);
+    const int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+    return true;
+#endif
+}
+
+} // namespace
+
+PipelineCacheStore::PipelineCacheStore(const Device &device, const PhysicalDevice &physicalDevice, std::string path, Codec codec)
+    : path_(std::move(path))
+    , codec_(std::move(codec))
+{
+    assert(device && physicalDevice);
+
+    const auto properties = physicalDevice.GetProperties();
+
+    MappedFile file(path_);
+    FileHeader header;
+    if (file && file.Size() >= sizeof(header))
+    {
+        memcpy(&header, file.Data(), sizeof(header));
+
+        const char *pData = file.Data() + sizeof(header);
+        if (header.magic == FILE_MAGIC && header.version == FILE_VERSION &&
+            header.dataSize == file.Size() - sizeof(header) && header.checksum == Checksum(pData, header.dataSize))
+        {
+            std::vector<char> decompressed;
+            if ((header.flags & FILE_FLAG_COMPRESSED) != 0)
+            {
+                decompressed.resize(header.uncompressedSize);
+                if (!codec_.decompress || !codec_.decompress(pData, header.dataSize, decompressed.data(), decompressed.size()))
+                {
+                    decompressed.clear();
+                }
+                pData = decompressed.data();
+            }
+
+            const auto dataSize = (header.flags & FILE_FLAG_COMPRESSED) != 0 ? decompressed.size() : header.dataSize;
+            if (IsCompatible(pData, dataSize, properties))
+            {
+                // the driver may still reject the data, e.g. if it has been truncated in a way the checks above cannot detect
+                try
+                {
+                    cache_ = device.CreatePipelineCache(dataSize, pData);
+                    loaded_ = true;
+                }
+                catch (const Exception&)
+                {
+                }
+            }
+        }
+    }
+
+    if (!cache_)
+    {
+        cache_ = device.CreatePipelineCache();
+    }
+}
+
+PipelineCacheStore::~PipelineCacheStore()
+{
+    WaitForSave();
+}
+
+bool PipelineCacheStore::Save()
+{
+    WaitForSave();
+
+    saveResult_ = Write(cache_.GetData());
+    return saveResult_;
+}
+
+void PipelineCacheStore::SaveAsync()
+{
+    WaitForSave();
+
+    saveThread_ = std::thread([this, data = cache_.GetData()]() { saveResult_ = Write(data); });
+}
+
+bool PipelineCacheStore::WaitForSave()
+{
+    if (saveThread_.joinable())
+    {
+        saveThread_.join();
+    }
+    return saveResult_;
+}
+
+bool PipelineCacheStore::Write(const std::vector<char> &data) const
+{
+    if (data.empty())
+    {
+        return false;
+    }
+
+    FileHeader header = {FILE_MAGIC, FILE_VERSION, 0, 0, data.size(), data.size()};
+
+    std::vector<char> compressed;
+    if (codec_.compress)
+    {
+        compressed = codec_.compress(data.data(), data.size());
+        // keep the raw data if compression does not pay off
+        if (!compressed.empty() && compressed.size() < data.size())
+        {
+            header.flags |= FILE_FLAG_COMPRESSED;
+            header.dataSize = compressed.size();
+        }
+    }
+
+    const char *pData = (header.flags & FILE_FLAG_COMPRESSED) != 0 ? compressed.data() : data.data();
+    header.checksum = Checksum(pData, header.dataSize);
+
+    const auto tempPath = path_ + ".tmp";
+    if (!WriteFileDurably(tempPath, header, pData))
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    return ReplaceFile(tempPath, path_);
+}
+
+} // namespace vkw
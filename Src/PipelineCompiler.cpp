@@ -0,0 +1,246 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "Error.h"
+
+namespace vkw
+{
+
+namespace
+{
+
+// the batch creation returns empty pipelines instead of failing for VK_PIPELINE_COMPILE_REQUIRED_EXT
+void SetPipeline(std::promise<Pipeline> &promise, Pipeline &&pipeline)
+{
+    if (pipeline)
+    {
+        promise.set_value(std::move(pipeline));
+    }
+    else
+    {
+        promise.set_exception(std::make_exception_ptr(Exception(VK_PIPELINE_COMPILE_REQUIRED_EXT)));
+    }
+}
+
+} // namespace
+
+PipelineCompiler::PipelineCompiler(const Device &device, const PipelineCache &pipelineCache, uint32_t threadCount)
+    : device_(std::make_shared<const Device>(device.GetView()))
+    , pipelineCache_(pipelineCache ? &pipelineCache : nullptr)
+{
+    assert(device);
+
+    if (threadCount == 0)
+    {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    const auto initialData = pipelineCache ? pipelineCache.GetData() : std::vector<char>();
+    workerCaches_.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        workerCaches_.push_back(device.CreatePipelineCache(initialData.size(), initialData.empty() ? nullptr : initialData.data()));
+    }
+
+    threads_.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        threads_.emplace_back(&PipelineCompiler::Run, this, i);
+    }
+}
+
+PipelineCompiler::~PipelineCompiler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto &thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+std::vector<std::future<Pipeline>> PipelineCompiler::CompileGraphicsPipelines(const Span<GraphicsPipelineDescription> &descriptions)
+{
+    return Compile(descriptions, [](const Device &device, const std::vector<GraphicsPipelineDescription> &group, const PipelineCache &cache)
+    {
+        return device.CreateGraphicsPipelines(group, cache);
+    });
+}
+
+std::vector<std::future<Pipeline>> PipelineCompiler::CompileComputePipelines(const Span<ComputePipelineDescription> &descriptions)
+{
+    return Compile(descriptions, [](const Device &device, const std::vector<ComputePipelineDescription> &group, const PipelineCache &cache)
+    {
+        return device.CreateComputePipelines(group, cache);
+    });
+}
+
+std::future<Pipeline> PipelineCompiler::Submit(std::function<Pipeline(const Device &device, const PipelineCache &pipelineCache)> create)
+{
+    assert(create);
+
+    auto promise = std::make_shared<std::promise<Pipeline>>();
+    auto future = promise->get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back([device = device_, promise, create = std::move(create)](const PipelineCache &cache)
+        {
+            try
+            {
+                SetPipeline(*promise, create(*device, cache));
+            }
+            catch (...)
+            {
+                promise->set_exception(std::current_exception());
+            }
+        });
+        ++pendingJobs_;
+    }
+    cv_.notify_one();
+
+    return future;
+}
+
+template <typename T, typename F>
+std::vector<std::future<Pipeline>> PipelineCompiler::Compile(const Span<T> &descriptions, F &&create)
+{
+    struct Group
+    {
+        std::vector<T> descriptions;
+        std::vector<std::promise<Pipeline>> promises;
+    };
+
+    const auto count = descriptions.Count();
+    std::vector<std::future<Pipeline>> futures(count);
+
+    // every pipeline goes into the group of its root base pipeline, base indices are rebased onto the group
+    std::vector<std::shared_ptr<Group>> groups;
+    std::vector<std::pair<uint32_t, int32_t>> groupIndices(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        auto description = descriptions[i];
+        assert(description.basePipelineIndex < static_cast<int32_t>(i));
+
+        uint32_t groupIndex;
+        if (description.basePipelineIndex < 0)
+        {
+            groupIndex = static_cast<uint32_t>(groups.size());
+            groups.push_back(std::make_shared<Group>());
+        }
+        else
+        {
+            groupIndex = groupIndices[description.basePipelineIndex].first;
+            description.basePipelineIndex = groupIndices[description.basePipelineIndex].second;
+        }
+
+        auto &group = *groups[groupIndex];
+        groupIndices[i] = {groupIndex, static_cast<int32_t>(group.descriptions.size())};
+        group.descriptions.push_back(std::move(description));
+        group.promises.emplace_back();
+        futures[i] = group.promises.back().get_future();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &group : groups)
+        {
+            jobs_.push_back([device = device_, group, create](const PipelineCache &cache)
+            {
+                try
+                {
+                    auto pipelines = create(*device, group->descriptions, cache);
+                    for (size_t i = 0; i < pipelines.size(); ++i)
+                    {
+                        SetPipeline(group->promises[i], std::move(pipelines[i]));
+                    }
+                }
+                catch (...)
+                {
+                    for (auto &promise : group->promises)
+                    {
+                        promise.set_exception(std::current_exception());
+                    }
+                }
+            });
+        }
+        pendingJobs_ += static_cast<uint32_t>(groups.size());
+    }
+    cv_.notify_all();
+
+    return futures;
+}
+
+void PipelineCompiler::Wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    idleCv_.wait(lock, [&] { return pendingJobs_ == 0; });
+}
+
+void PipelineCompiler::Merge()
+{
+    Wait();
+
+    if (pipelineCache_ != nullptr)
+    {
+        pipelineCache_->Merge(workerCaches_);
+    }
+}
+
+void PipelineCompiler::Run(uint32_t workerIndex)
+{
+    const auto &cache = workerCaches_[workerIndex];
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [&] { return stop_ || !jobs_.empty(); });
+            if (jobs_.empty())
+            {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        job(cache);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --pendingJobs_;
+            if (pendingJobs_ == 0)
+            {
+                idleCv_.notify_all();
+            }
+        }
+    }
+}
+
+} // namespace vkw
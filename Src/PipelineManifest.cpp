@@ -0,0 +1,765 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Error.h"
+#include "Serialization.h"
+
+namespace vkw
+{
+
+namespace
+{
+
+constexpr uint32_t MANIFEST_MAGIC = 0x4d504b56; // "VKPM"
+constexpr uint32_t MANIFEST_VERSION = 1;
+
+constexpr VkGraphicsPipelineLibraryFlagsEXT ALL_GRAPHICS_PIPELINE_LIBRARY_PARTS =
+    VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT | VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT |
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT | VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+
+constexpr uint8_t PIPELINE_GRAPHICS = 0;
+constexpr uint8_t PIPELINE_COMPUTE = 1;
+
+// upper bound of maxViewports for counts of dynamic viewports and scissors read from a manifest
+constexpr uint32_t MAX_VIEWPORT_COUNT = 256;
+
+// flags which describe how a pipeline was created in the session rather than the pipeline itself
+constexpr VkPipelineCreateFlags SESSION_FLAGS = VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT | VK_PIPELINE_CREATE_DERIVATIVE_BIT |
+                                                VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT;
+
+// bounds checked, reading past the end makes the reader invalid and returns zeros
+class Reader
+{
+public:
+
+    Reader() = default;
+    Reader(const char *data, size_t size)
+        : data_(data), size_(size), valid_(true) {}
+
+    bool IsValid() const
+    {
+        return valid_;
+    }
+
+    template <typename T>
+    T Read()
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable!");
+        T value = {};
+        if (Check(sizeof(T)))
+        {
+            memcpy(&value, data_ + position_, sizeof(T));
+            position_ += sizeof(T);
+        }
+        return value;
+    }
+
+    template <typename T>
+    std::vector<T> ReadArray()
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable!");
+        const auto count = Read<uint32_t>();
+        if (!valid_ || count > (size_ - position_) / sizeof(T))
+        {
+            valid_ = false;
+            return {};
+        }
+        std::vector<T> values(count);
+        if (count > 0)
+        {
+            memcpy(values.data(), data_ + position_, sizeof(T) * count);
+            position_ += sizeof(T) * count;
+        }
+        return values;
+    }
+
+    // a count which is not followed by the elements, larger counts than maxCount make the reader invalid
+    uint32_t ReadCount(uint32_t maxCount)
+    {
+        const auto count = Read<uint32_t>();
+        valid_ = valid_ && count <= maxCount;
+        return valid_ ? count : 0;
+    }
+
+    std::string ReadString()
+    {
+        const auto chars = ReadArray<char>();
+        return std::string(chars.cbegin(), chars.cend());
+    }
+
+    Reader ReadEntry()
+    {
+        const auto size = Read<uint32_t>();
+        if (!Check(size))
+        {
+            return {};
+        }
+        const Reader entry(data_ + position_, size);
+        position_ += size;
+        return entry;
+    }
+
+private:
+
+    bool Check(size_t size)
+    {
+        valid_ = valid_ && size <= size_ - position_;
+        return valid_;
+    }
+
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    size_t position_ = 0;
+    bool valid_ = false;
+};
+
+template <typename T>
+bool Contains(const std::vector<T> &values, T value)
+{
+    return std::find(values.cbegin(), values.cend(), value) != values.cend();
+}
+
+template <typename T>
+bool Find(const std::unordered_map<T, uint32_t> &objects, T object, uint32_t &index)
+{
+    const auto it = objects.find(object);
+    if (it == objects.end())
+    {
+        return false;
+    }
+    index = it->second;
+    return true;
+}
+
+template <typename T>
+Span<T> MakeSpan(const std::vector<T> &values)
+{
+    return Span<T>(values.data(), values.size());
+}
+
+struct SpecializationData
+{
+    std::vector<uint8_t> data;
+    SpecializationInfo info;
+};
+
+// owns everything the description of a replayed pipeline points to
+struct ReplayedPipeline
+{
+    GraphicsPipelineDescription graphics;
+    ComputePipelineDescription compute;
+    Pipeline::TessellationState tessellationState;
+    Pipeline::ViewportState viewportState;
+    Pipeline::MultisampleState multisampleState;
+    std::vector<VkSampleMask> sampleMask;
+    Pipeline::DepthStencilState depthStencilState;
+    Pipeline::ColorBlendState colorBlendState;
+    Pipeline::DynamicState dynamicState;
+    std::list<SpecializationData> specializations;
+};
+
+// the counterpart of AppendGraphicsPipelineState with all parts
+void ReadState(Reader &reader, ReplayedPipeline &pipeline)
+{
+    auto &state = pipeline.graphics.state;
+
+    if (reader.Read<uint8_t>() != 0)
+    {
+        auto &dynamicState = pipeline.dynamicState;
+        dynamicState.flags = reader.Read<VkPipelineDynamicStateCreateFlags>();
+        dynamicState.dynamicStates = reader.ReadArray<VkDynamicState>();
+        state.dynamicState = &dynamicState;
+    }
+    const auto isDynamic = [&](VkDynamicState dynamicState)
+    {
+        return state.dynamicState != nullptr && Contains(state.dynamicState->dynamicStates, dynamicState);
+    };
+
+    auto &vertexInputState = state.vertexInputState;
+    vertexInputState.flags = reader.Read<VkPipelineVertexInputStateCreateFlags>();
+    vertexInputState.vertexBindingDescriptions = reader.ReadArray<VkVertexInputBindingDescription>();
+    vertexInputState.vertexAttributeDescriptions = reader.ReadArray<VkVertexInputAttributeDescription>();
+
+    auto &inputAssemblyState = state.inputAssemblyState;
+    inputAssemblyState.flags = reader.Read<VkPipelineInputAssemblyStateCreateFlags>();
+    inputAssemblyState.topology = reader.Read<VkPrimitiveTopology>();
+    inputAssemblyState.primitiveRestartEnable = reader.Read<VkBool32>();
+
+    if (reader.Read<uint8_t>() != 0)
+    {
+        auto &tessellationState = pipeline.tessellationState;
+        tessellationState.flags = reader.Read<VkPipelineTessellationStateCreateFlags>();
+        tessellationState.patchControlPoints = reader.Read<uint32_t>();
+        state.tessellationState = &tessellationState;
+    }
+
+    if (reader.Read<uint8_t>() != 0)
+    {
+        // dynamic viewports and scissors only keep their count
+        auto &viewportState = pipeline.viewportState;
+        viewportState.flags = reader.Read<VkPipelineViewportStateCreateFlags>();
+        if (isDynamic(VK_DYNAMIC_STATE_VIEWPORT))
+        {
+            viewportState.viewports.resize(reader.ReadCount(MAX_VIEWPORT_COUNT));
+        }
+        else
+        {
+            viewportState.viewports = reader.ReadArray<VkViewport>();
+        }
+        if (isDynamic(VK_DYNAMIC_STATE_SCISSOR))
+        {
+            viewportState.scissors.resize(reader.ReadCount(MAX_VIEWPORT_COUNT));
+        }
+        else
+        {
+            viewportState.scissors = reader.ReadArray<VkRect2D>();
+        }
+        state.viewportState = &viewportState;
+    }
+
+    auto &rasterizationState = state.rasterizationState;
+    rasterizationState.flags = reader.Read<VkPipelineRasterizationStateCreateFlags>();
+    rasterizationState.depthClampEnable = reader.Read<VkBool32>();
+    rasterizationState.rasterizerDiscardEnable = reader.Read<VkBool32>();
+    rasterizationState.polygonMode = reader.Read<VkPolygonMode>();
+    rasterizationState.cullMode = reader.Read<VkCullModeFlags>();
+    rasterizationState.frontFace = reader.Read<VkFrontFace>();
+    rasterizationState.depthBiasEnable = reader.Read<VkBool32>();
+    if (rasterizationState.depthBiasEnable && !isDynamic(VK_DYNAMIC_STATE_DEPTH_BIAS))
+    {
+        rasterizationState.depthBiasConstantFactor = reader.Read<float>();
+        rasterizationState.depthBiasClamp = reader.Read<float>();
+        rasterizationState.depthBiasSlopeFactor = reader.Read<float>();
+    }
+    if (!isDynamic(VK_DYNAMIC_STATE_LINE_WIDTH))
+    {
+        rasterizationState.lineWidth = reader.Read<float>();
+    }
+
+    if (reader.Read<uint8_t>() != 0)
+    {
+        auto &multisampleState = pipeline.multisampleState;
+        multisampleState.flags = reader.Read<VkPipelineMultisampleStateCreateFlags>();
+        multisampleState.rasterizationSamples = reader.Read<VkSampleCountFlagBits>();
+        multisampleState.sampleShadingEnable = reader.Read<VkBool32>();
+        multisampleState.minSampleShading = reader.Read<float>();
+        pipeline.sampleMask = reader.ReadArray<VkSampleMask>();
+        multisampleState.pSampleMask = pipeline.sampleMask.empty() ? nullptr : pipeline.sampleMask.data();
+        multisampleState.alphaToCoverageEnable = reader.Read<VkBool32>();
+        multisampleState.alphaToOneEnable = reader.Read<VkBool32>();
+        state.multisampleState = &multisampleState;
+    }
+
+    if (reader.Read<uint8_t>() != 0)
+    {
+        auto &depthStencilState = pipeline.depthStencilState;
+        depthStencilState.flags = reader.Read<VkPipelineDepthStencilStateCreateFlags>();
+        depthStencilState.depthTestEnable = reader.Read<VkBool32>();
+        depthStencilState.depthWriteEnable = reader.Read<VkBool32>();
+        depthStencilState.depthCompareOp = reader.Read<VkCompareOp>();
+        depthStencilState.depthBoundsTestEnable = reader.Read<VkBool32>();
+        depthStencilState.stencilTestEnable = reader.Read<VkBool32>();
+        depthStencilState.front = reader.Read<VkStencilOpState>();
+        depthStencilState.back = reader.Read<VkStencilOpState>();
+        if ((depthStencilState.depthBoundsTestEnable || isDynamic(VK_DYNAMIC_STATE_DEPTH_BOUNDS_TEST_ENABLE_EXT)) && !isDynamic(VK_DYNAMIC_STATE_DEPTH_BOUNDS))
+        {
+            depthStencilState.minDepthBounds = reader.Read<float>();
+            depthStencilState.maxDepthBounds = reader.Read<float>();
+        }
+        state.depthStencilState = &depthStencilState;
+    }
+
+    if (reader.Read<uint8_t>() != 0)
+    {
+        auto &colorBlendState = pipeline.colorBlendState;
+        colorBlendState.flags = reader.Read<VkPipelineColorBlendStateCreateFlags>();
+        colorBlendState.logicOpEnable = reader.Read<VkBool32>();
+        if (colorBlendState.logicOpEnable)
+        {
+            colorBlendState.logicOp = reader.Read<VkLogicOp>();
+        }
+        colorBlendState.attachments = reader.ReadArray<VkPipelineColorBlendAttachmentState>();
+        if (!isDynamic(VK_DYNAMIC_STATE_BLEND_CONSTANTS))
+        {
+            for (auto &blendConstant : colorBlendState.blendConstants)
+            {
+                blendConstant = reader.Read<float>();
+            }
+        }
+        state.colorBlendState = &colorBlendState;
+    }
+}
+
+// the counterpart of the module index followed by AppendShaderStage
+bool ReadStage(Reader &reader, const std::vector<std::shared_ptr<const ShaderModule>> &shaderModules,
+               ReplayedPipeline &pipeline, Pipeline::ShaderStage &stage)
+{
+    const auto moduleIndex = reader.Read<uint32_t>();
+    stage.flags = reader.Read<VkPipelineShaderStageCreateFlags>();
+    stage.stage = reader.Read<VkShaderStageFlagBits>();
+    stage.entryPointName = reader.ReadString();
+    if (moduleIndex >= shaderModules.size() || shaderModules[moduleIndex] == nullptr)
+    {
+        return false;
+    }
+    stage.module = shaderModules[moduleIndex].get();
+
+    if (reader.Read<uint8_t>() != 0)
+    {
+        pipeline.specializations.emplace_back();
+        auto &specialization = pipeline.specializations.back();
+        std::vector<VkSpecializationMapEntry> mapEntries;
+        const auto mapEntryCount = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < mapEntryCount && reader.IsValid(); ++i)
+        {
+            const auto constantID = reader.Read<uint32_t>();
+            const auto offset = reader.Read<uint32_t>();
+            const auto size = reader.Read<uint32_t>();
+            mapEntries.push_back({constantID, offset, size});
+        }
+        specialization.data = reader.ReadArray<uint8_t>();
+        specialization.info = SpecializationInfo(specialization.data.empty() ? nullptr : specialization.data.data(),
+                                                 specialization.data.size(), MakeSpan(mapEntries));
+        stage.pSpecializationInfo = &specialization.info;
+    }
+    return reader.IsValid();
+}
+
+} // namespace
+
+uint32_t PipelineManifest::Table::Add(std::string &&entry)
+{
+    const auto it = indices.find(entry);
+    if (it != indices.end())
+    {
+        return it->second;
+    }
+
+    const auto index = static_cast<uint32_t>(entries.size());
+    indices.emplace(entry, index);
+    entries.push_back(std::move(entry));
+    return index;
+}
+
+void PipelineManifest::RecordShaderModule(const void *pNext, VkShaderModule shaderModule, const Span<uint32_t> &code)
+{
+    if (pNext != nullptr)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shaderModuleIndices_.erase(shaderModule);
+        return;
+    }
+
+    std::string entry;
+    AppendBytes(entry, ShaderLibrary::Hash(code));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    shaderModuleIndices_[shaderModule] = shaderModules_.Add(std::move(entry));
+}
+
+void PipelineManifest::RecordDescriptorSetLayout(const void *pNext, VkDescriptorSetLayout setLayout, const Span<VkDescriptorSetLayoutBinding> &bindings,
+                                                 const Span<VkDescriptorBindingFlags> &bindingFlags, VkDescriptorSetLayoutCreateFlags flags)
+{
+    std::string entry;
+    AppendBytes(entry, flags);
+    AppendBytes(entry, bindings.Count());
+    bool recordable = pNext == nullptr;
+    for (const auto &binding : bindings)
+    {
+        // samplers cannot be referenced across sessions
+        recordable = recordable && binding.pImmutableSamplers == nullptr;
+        AppendBytes(entry, binding.binding);
+        AppendBytes(entry, binding.descriptorType);
+        AppendBytes(entry, binding.descriptorCount);
+        AppendBytes(entry, binding.stageFlags);
+    }
+    AppendArray(entry, bindingFlags.Data(), bindingFlags.Count());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (recordable)
+    {
+        setLayoutIndices_[setLayout] = setLayouts_.Add(std::move(entry));
+    }
+    else
+    {
+        // the handle may have belonged to a destroyed layout which has been recorded
+        setLayoutIndices_.erase(setLayout);
+    }
+}
+
+void PipelineManifest::RecordPipelineLayout(const void *pNext, VkPipelineLayout pipelineLayout, const Span2<DescriptorSetLayout> &setLayouts,
+                                            const Span<VkPushConstantRange> &pushConstantRanges, VkPipelineLayoutCreateFlags flags)
+{
+    if (pNext != nullptr)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pipelineLayoutIndices_.erase(pipelineLayout);
+        return;
+    }
+
+    std::string entry;
+    AppendBytes(entry, flags);
+    AppendArray(entry, pushConstantRanges.Data(), pushConstantRanges.Count());
+    AppendBytes(entry, setLayouts.Count());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint32_t i = 0; i < setLayouts.Count(); ++i)
+    {
+        uint32_t setLayoutIndex;
+        if (!Find(setLayoutIndices_, VkDescriptorSetLayout(setLayouts[i]), setLayoutIndex))
+        {
+            pipelineLayoutIndices_.erase(pipelineLayout);
+            return;
+        }
+        AppendBytes(entry, setLayoutIndex);
+    }
+    pipelineLayoutIndices_[pipelineLayout] = pipelineLayouts_.Add(std::move(entry));
+}
+
+void PipelineManifest::RecordRenderPass(const void *pNext, VkRenderPass renderPass, const Span<AttachmentDescription> &attachments,
+                                        const Span<SubpassDescription> &subpasses, const Span<SubpassDependency> &dependencies, VkRenderPassCreateFlags flags)
+{
+    if (pNext != nullptr)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        renderPassIndices_.erase(renderPass);
+        return;
+    }
+
+    std::string entry;
+    AppendBytes(entry, flags);
+    AppendArray(entry, attachments.Data(), attachments.Count());
+    AppendBytes(entry, subpasses.Count());
+    for (const auto &subpass : subpasses)
+    {
+        AppendBytes(entry, subpass.flags);
+        AppendBytes(entry, subpass.pipelineBindPoint);
+        AppendArray(entry, subpass.inputAttachments);
+        AppendArray(entry, subpass.colorAttachments);
+        AppendArray(entry, subpass.resolveAttachments);
+        AppendBytes(entry, subpass.depthStencilAttachment);
+        AppendArray(entry, subpass.preserveAttachments);
+    }
+    AppendArray(entry, dependencies.Data(), dependencies.Count());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    renderPassIndices_[renderPass] = renderPasses_.Add(std::move(entry));
+}
+
+void PipelineManifest::RecordGraphicsPipeline(const RenderPass &renderPass, uint32_t subpass, const Span<Pipeline::ShaderStage> &stages,
+                                              const PipelineLayout &layout, const GraphicsPipelineStateDescription &state, VkPipelineCreateFlags flags)
+{
+    std::string entry;
+    AppendBytes(entry, PIPELINE_GRAPHICS);
+    AppendBytes(entry, flags & ~SESSION_FLAGS);
+    AppendBytes(entry, subpass);
+    if (!AppendGraphicsPipelineState(entry, state, ALL_GRAPHICS_PIPELINE_LIBRARY_PARTS))
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t renderPassIndex;
+    uint32_t layoutIndex;
+    if (!Find(renderPassIndices_, VkRenderPass(renderPass), renderPassIndex) || !Find(pipelineLayoutIndices_, VkPipelineLayout(layout), layoutIndex))
+    {
+        return;
+    }
+    AppendBytes(entry, renderPassIndex);
+    AppendBytes(entry, layoutIndex);
+    AppendBytes(entry, stages.Count());
+    for (const auto &stage : stages)
+    {
+        if (!AppendStage(entry, stage))
+        {
+            return;
+        }
+    }
+    pipelines_.Add(std::move(entry));
+}
+
+void PipelineManifest::RecordComputePipeline(const Pipeline::ShaderStage &stage, const PipelineLayout &layout, VkPipelineCreateFlags flags)
+{
+    std::string entry;
+    AppendBytes(entry, PIPELINE_COMPUTE);
+    AppendBytes(entry, flags & ~SESSION_FLAGS);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t layoutIndex;
+    if (!Find(pipelineLayoutIndices_, VkPipelineLayout(layout), layoutIndex))
+    {
+        return;
+    }
+    AppendBytes(entry, layoutIndex);
+    if (AppendStage(entry, stage))
+    {
+        pipelines_.Add(std::move(entry));
+    }
+}
+
+bool PipelineManifest::AppendStage(std::string &data, const Pipeline::ShaderStage &stage) const
+{
+    uint32_t moduleIndex;
+    if (stage.module == nullptr || !Find(shaderModuleIndices_, VkShaderModule(*stage.module), moduleIndex))
+    {
+        return false;
+    }
+
+    AppendBytes(data, moduleIndex);
+    return AppendShaderStage(data, stage);
+}
+
+size_t PipelineManifest::GetPipelineCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pipelines_.entries.size();
+}
+
+std::vector<char> PipelineManifest::Serialize() const
+{
+    std::string data;
+    AppendBytes(data, MANIFEST_MAGIC);
+    AppendBytes(data, MANIFEST_VERSION);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto table : {&shaderModules_, &setLayouts_, &pipelineLayouts_, &renderPasses_, &pipelines_})
+    {
+        AppendBytes(data, static_cast<uint32_t>(table->entries.size()));
+        for (const auto &entry : table->entries)
+        {
+            AppendArray(data, entry.data(), entry.size());
+        }
+    }
+    return std::vector<char>(data.cbegin(), data.cend());
+}
+
+size_t PipelineManifest::Replay(const Device &device, const std::vector<char> &manifest, const ShaderModuleLookup &lookup, PipelineCompiler &compiler)
+{
+    assert(device && lookup);
+
+    Reader reader(manifest.data(), manifest.size());
+    if (reader.Read<uint32_t>() != MANIFEST_MAGIC || reader.Read<uint32_t>() != MANIFEST_VERSION)
+    {
+        return 0;
+    }
+
+    // shader modules, set layouts, pipeline layouts, render passes, pipelines
+    std::array<std::vector<Reader>, 5> tables;
+    for (auto &table : tables)
+    {
+        const auto entryCount = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < entryCount && reader.IsValid(); ++i)
+        {
+            table.push_back(reader.ReadEntry());
+        }
+    }
+    if (!reader.IsValid())
+    {
+        return 0;
+    }
+
+    std::vector<std::shared_ptr<const ShaderModule>> shaderModules;
+    for (auto &entry : tables[0])
+    {
+        const auto hash = entry.Read<uint64_t>();
+        shaderModules.push_back(entry.IsValid() ? lookup(hash) : nullptr);
+    }
+
+    std::vector<DescriptorSetLayout> setLayouts(tables[1].size());
+    for (size_t i = 0; i < setLayouts.size(); ++i)
+    {
+        auto &entry = tables[1][i];
+        const auto flags = entry.Read<VkDescriptorSetLayoutCreateFlags>();
+        const auto bindingCount = entry.Read<uint32_t>();
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+        for (uint32_t j = 0; j < bindingCount && entry.IsValid(); ++j)
+        {
+            const auto binding = entry.Read<uint32_t>();
+            const auto descriptorType = entry.Read<VkDescriptorType>();
+            const auto descriptorCount = entry.Read<uint32_t>();
+            const auto stageFlags = entry.Read<VkShaderStageFlags>();
+            bindings.push_back({binding, descriptorType, descriptorCount, stageFlags, nullptr});
+        }
+        const auto bindingFlags = entry.ReadArray<VkDescriptorBindingFlags>();
+        if (!entry.IsValid())
+        {
+            continue;
+        }
+
+        if (bindingFlags.empty())
+        {
+            setLayouts[i] = device.CreateDescriptorSetLayout(MakeSpan(bindings), flags);
+        }
+        else if (bindingFlags.size() == bindings.size())
+        {
+            setLayouts[i] = device.CreateDescriptorSetLayout(MakeSpan(bindings), MakeSpan(bindingFlags), flags);
+        }
+    }
+
+    std::vector<PipelineLayout> pipelineLayouts(tables[2].size());
+    for (size_t i = 0; i < pipelineLayouts.size(); ++i)
+    {
+        auto &entry = tables[2][i];
+        const auto flags = entry.Read<VkPipelineLayoutCreateFlags>();
+        const auto pushConstantRanges = entry.ReadArray<VkPushConstantRange>();
+        const auto setLayoutCount = entry.Read<uint32_t>();
+        std::vector<const DescriptorSetLayout*> pSetLayouts;
+        for (uint32_t j = 0; j < setLayoutCount && entry.IsValid(); ++j)
+        {
+            const auto setLayoutIndex = entry.Read<uint32_t>();
+            if (setLayoutIndex < setLayouts.size() && setLayouts[setLayoutIndex])
+            {
+                pSetLayouts.push_back(&setLayouts[setLayoutIndex]);
+            }
+        }
+        if (!entry.IsValid() || pSetLayouts.size() != setLayoutCount)
+        {
+            continue;
+        }
+
+        const auto setLayoutSpan = pSetLayouts.empty() ? Span2<DescriptorSetLayout>() : Span2<DescriptorSetLayout>(pSetLayouts.data(), pSetLayouts.size());
+        pipelineLayouts[i] = device.CreatePipelineLayout(setLayoutSpan, MakeSpan(pushConstantRanges), flags);
+    }
+
+    std::vector<RenderPass> renderPasses(tables[3].size());
+    for (size_t i = 0; i < renderPasses.size(); ++i)
+    {
+        auto &entry = tables[3][i];
+        const auto flags = entry.Read<VkRenderPassCreateFlags>();
+        const auto attachments = entry.ReadArray<AttachmentDescription>();
+        const auto subpassCount = entry.Read<uint32_t>();
+        std::vector<SubpassDescription> subpasses;
+        for (uint32_t j = 0; j < subpassCount && entry.IsValid(); ++j)
+        {
+            subpasses.emplace_back();
+            auto &subpass = subpasses.back();
+            subpass.flags = entry.Read<VkSubpassDescriptionFlags>();
+            subpass.pipelineBindPoint = entry.Read<VkPipelineBindPoint>();
+            subpass.inputAttachments = entry.ReadArray<VkAttachmentReference>();
+            subpass.colorAttachments = entry.ReadArray<VkAttachmentReference>();
+            subpass.resolveAttachments = entry.ReadArray<VkAttachmentReference>();
+            subpass.depthStencilAttachment = entry.Read<VkAttachmentReference>();
+            subpass.preserveAttachments = entry.ReadArray<uint32_t>();
+        }
+        const auto dependencies = entry.ReadArray<SubpassDependency>();
+        if (!entry.IsValid() || subpasses.empty())
+        {
+            continue;
+        }
+
+        renderPasses[i] = device.CreateRenderPass(MakeSpan(attachments), MakeSpan(subpasses), MakeSpan(dependencies), flags);
+    }
+
+    std::vector<std::unique_ptr<ReplayedPipeline>> replayedPipelines;
+    std::vector<GraphicsPipelineDescription> graphicsDescriptions;
+    std::vector<ComputePipelineDescription> computeDescriptions;
+    for (auto &entry : tables[4])
+    {
+        auto pipeline = std::make_unique<ReplayedPipeline>();
+        const auto type = entry.Read<uint8_t>();
+        const auto flags = entry.Read<VkPipelineCreateFlags>();
+        if (type == PIPELINE_GRAPHICS)
+        {
+            auto &description = pipeline->graphics;
+            description.flags = flags;
+            description.subpass = entry.Read<uint32_t>();
+            ReadState(entry, *pipeline);
+            const auto renderPassIndex = entry.Read<uint32_t>();
+            const auto layoutIndex = entry.Read<uint32_t>();
+            if (renderPassIndex >= renderPasses.size() || !renderPasses[renderPassIndex] ||
+                layoutIndex >= pipelineLayouts.size() || !pipelineLayouts[layoutIndex])
+            {
+                continue;
+            }
+            description.renderPass = &renderPasses[renderPassIndex];
+            description.layout = &pipelineLayouts[layoutIndex];
+
+            const auto stageCount = entry.Read<uint32_t>();
+            bool complete = entry.IsValid() && stageCount > 0;
+            for (uint32_t i = 0; i < stageCount && complete; ++i)
+            {
+                description.stages.emplace_back();
+                complete = ReadStage(entry, shaderModules, *pipeline, description.stages.back());
+            }
+            if (complete)
+            {
+                graphicsDescriptions.push_back(description);
+                replayedPipelines.push_back(std::move(pipeline));
+            }
+        }
+        else if (type == PIPELINE_COMPUTE)
+        {
+            auto &description = pipeline->compute;
+            description.flags = flags;
+            const auto layoutIndex = entry.Read<uint32_t>();
+            if (layoutIndex >= pipelineLayouts.size() || !pipelineLayouts[layoutIndex])
+            {
+                continue;
+            }
+            description.layout = &pipelineLayouts[layoutIndex];
+
+            if (ReadStage(entry, shaderModules, *pipeline, description.stage))
+            {
+                computeDescriptions.push_back(description);
+                replayedPipelines.push_back(std::move(pipeline));
+            }
+        }
+    }
+
+    // the compiler spreads the batches over its threads, the pipelines are only needed for their cache entries
+    std::vector<std::future<Pipeline>> futures;
+    if (!graphicsDescriptions.empty())
+    {
+        futures = compiler.CompileGraphicsPipelines(MakeSpan(graphicsDescriptions));
+    }
+    if (!computeDescriptions.empty())
+    {
+        for (auto &future : compiler.CompileComputePipelines(MakeSpan(computeDescriptions)))
+        {
+            futures.push_back(std::move(future));
+        }
+    }
+
+    size_t compiledCount = 0;
+    for (auto &future : futures)
+    {
+        try
+        {
+            future.get();
+            ++compiledCount;
+        }
+        catch (const Exception&)
+        {
+            // e.g. a driver update changed the supported features
+        }
+    }
+    compiler.Merge();
+
+    return compiledCount;
+}
+
+} // namespace vkw
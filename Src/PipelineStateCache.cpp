@@ -0,0 +1,184 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include <algorithm>
+
+#include "Error.h"
+#include "Serialization.h"
+
+namespace vkw
+{
+
+namespace
+{
+
+constexpr VkGraphicsPipelineLibraryFlagsEXT ALL_GRAPHICS_PIPELINE_LIBRARY_PARTS =
+    VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT | VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT |
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT | VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+
+Pipeline Create(const Device &device, const GraphicsPipelineDescription &description, const PipelineCache &pipelineCache)
+{
+    return std::move(device.CreateGraphicsPipelines(description, pipelineCache).front());
+}
+
+Pipeline Create(const Device &device, const ComputePipelineDescription &description, const PipelineCache &pipelineCache)
+{
+    return std::move(device.CreateComputePipelines(description, pipelineCache).front());
+}
+
+} // namespace
+
+PipelineKey::PipelineKey(const GraphicsPipelineDescription &description)
+    : PipelineKey(description, ALL_GRAPHICS_PIPELINE_LIBRARY_PARTS)
+{}
+
+PipelineKey::PipelineKey(const GraphicsPipelineDescription &description, VkGraphicsPipelineLibraryFlagsEXT parts)
+{
+    const bool preRasterization = (parts & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT) != 0;
+    const bool fragmentShader = (parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT) != 0;
+    const bool fragmentOutput = (parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT) != 0;
+    assert(parts != 0 && (description.renderPass || !(preRasterization || fragmentShader || fragmentOutput)));
+    assert(description.layout || !(preRasterization || fragmentShader));
+
+    AppendBytes(data_, VK_PIPELINE_BIND_POINT_GRAPHICS);
+    AppendBytes(data_, parts);
+    AppendBytes(data_, description.flags);
+    if (preRasterization || fragmentShader || fragmentOutput)
+    {
+        AppendBytes(data_, VkRenderPass(*description.renderPass));
+        AppendBytes(data_, description.subpass);
+    }
+    if (preRasterization || fragmentShader)
+    {
+        AppendBytes(data_, VkPipelineLayout(*description.layout));
+    }
+
+    // the fragment stage belongs to the fragment shader part, all other stages to the pre-rasterization part
+    const auto isPartStage = [&](const Pipeline::ShaderStage &stage)
+    {
+        return stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT ? fragmentShader : preRasterization;
+    };
+    AppendBytes(data_, static_cast<uint32_t>(std::count_if(description.stages.cbegin(), description.stages.cend(), isPartStage)));
+    for (const auto &stage : description.stages)
+    {
+        if (isPartStage(stage))
+        {
+            AppendStage(stage);
+        }
+    }
+
+    if (!AppendGraphicsPipelineState(data_, description.state, parts))
+    {
+        // pNext chains are not supported
+        throw Exception(VK_ERROR_FEATURE_NOT_PRESENT);
+    }
+
+    hash_ = Fnv1a(data_.data(), data_.size());
+}
+
+PipelineKey::PipelineKey(const ComputePipelineDescription &description)
+{
+    assert(description.layout);
+
+    AppendBytes(data_, VK_PIPELINE_BIND_POINT_COMPUTE);
+    AppendBytes(data_, description.flags);
+    AppendBytes(data_, VkPipelineLayout(*description.layout));
+    AppendStage(description.stage);
+
+    hash_ = Fnv1a(data_.data(), data_.size());
+}
+
+void PipelineKey::AppendStage(const Pipeline::ShaderStage &stage)
+{
+    assert(stage.module);
+
+    AppendBytes(data_, VkShaderModule(*stage.module));
+    if (!AppendShaderStage(data_, stage))
+    {
+        // pNext chains are not supported
+        throw Exception(VK_ERROR_FEATURE_NOT_PRESENT);
+    }
+}
+
+PipelineStateCache::PipelineStateCache(const Device &device, const PipelineCache &pipelineCache)
+    : device_(std::make_shared<const Device>(device.GetView()))
+    , pipelineCache_(pipelineCache ? &pipelineCache : nullptr)
+{
+    assert(device);
+}
+
+const Pipeline& PipelineStateCache::Get(const GraphicsPipelineDescription &description)
+{
+    return Get<GraphicsPipelineDescription>(description);
+}
+
+const Pipeline& PipelineStateCache::Get(const ComputePipelineDescription &description)
+{
+    return Get<ComputePipelineDescription>(description);
+}
+
+size_t PipelineStateCache::GetSize() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return entries_.size();
+}
+
+template <typename T>
+const Pipeline& PipelineStateCache::Get(const T &description)
+{
+    assert(description.basePipelineIndex < 0);
+
+    PipelineKey key(description);
+
+    Entry *entry = nullptr;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        const auto it = entries_.find(key);
+        if (it != entries_.end())
+        {
+            entry = it->second.get();
+        }
+    }
+
+    if (entry == nullptr)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto &newEntry = entries_[std::move(key)];
+        if (!newEntry)
+        {
+            newEntry = std::make_unique<Entry>();
+        }
+        entry = newEntry.get();
+    }
+
+    // compiling happens outside of the lock, requests for the same pipeline wait here
+    std::call_once(entry->compiled, [&]()
+    {
+        static const PipelineCache noPipelineCache;
+        entry->pipeline = Create(*device_, description, pipelineCache_ != nullptr ? *pipelineCache_ : noPipelineCache);
+    });
+    return entry->pipeline;
+}
+
+} // namespace vkw
@@ -0,0 +1,50 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include "Error.h"
+
+namespace vkw
+{
+
+PresentBatch::PresentBatch(const Span2<Swapchain> &swapchains, const Span2<Semaphore> &waitSemaphores)
+    : PresentBatch(nullptr, swapchains, waitSemaphores)
+{}
+
+PresentBatch::PresentBatch(const void *pNext, const Span2<Swapchain> &swapchains, const Span2<Semaphore> &waitSemaphores)
+    : waitSemaphores_(waitSemaphores.Count())
+    , swapchains_(swapchains.Count())
+    , imageIndices_(swapchains.Count(), 0)
+    , results_(swapchains.Count(), VK_SUCCESS)
+{
+    assert(swapchains);
+
+    waitSemaphores.Emplace(waitSemaphores_.data());
+    swapchains.Emplace(swapchains_.data());
+
+    presentInfo_ = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR, pNext,
+                    static_cast<uint32_t>(waitSemaphores_.size()), waitSemaphores_.empty() ? nullptr : waitSemaphores_.data(),
+                    static_cast<uint32_t>(swapchains_.size()), swapchains_.data(), imageIndices_.data(), results_.data()};
+}
+
+} // namespace vkw
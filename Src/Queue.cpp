@@ -137,4 +137,41 @@ std::vector<VkResult> Queue::PresentExt(const void *pNext, const Span2<Swapchain
     return results;
 }
 
+void Queue::Submit(const Span2<SubmitBatch> &batches, const Fence &signalFence) const
+{
+    assert(queue_ && batches);
+
+    const auto submitCount = batches.Count();
+    auto pSubmits = static_cast<VkSubmitInfo*>(alloca(sizeof(VkSubmitInfo) * submitCount));
+    batches.Emplace(pSubmits);
+
+    VK_CALL(vkQueueSubmit(queue_, submitCount, pSubmits, VkFence(signalFence)));
+}
+
+VkResult Queue::Present(const PresentBatch &batch) const
+{
+    assert(queue_);
+
+    auto presentInfo = VkPresentInfoKHR(batch);
+    auto result = vkQueuePresentKHR(queue_, &presentInfo);
+    VK_CALL(result);
+
+    return result;
+}
+
+CompletionHandle Queue::Submit(CompletionService &service, const Span<CommandBuffer> &commandBuffers, const Span2<Semaphore> &waitSemaphores,
+                               const Span2<Semaphore> &signalSemaphores) const
+{
+    auto fence = service.AcquireFence();
+    Submit(commandBuffers, waitSemaphores, signalSemaphores, fence);
+    return service.Track(std::move(fence));
+}
+
+CompletionHandle Queue::Submit(CompletionService &service, const Span2<SubmitBatch> &batches) const
+{
+    auto fence = service.AcquireFence();
+    Submit(batches, fence);
+    return service.Track(std::move(fence));
+}
+
 } // namespace vkw
\ No newline at end of file
@@ -0,0 +1,80 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include "Error.h"
+
+namespace vkw
+{
+
+namespace
+{
+
+Semaphore CreatePooledSemaphore(VkDevice device, VkPipelineStageFlags pipelineStageFlag)
+{
+    VkSemaphoreCreateInfo createInfo = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    VkSemaphore semaphore;
+    VK_CALL(vkCreateSemaphore(device, &createInfo, nullptr, &semaphore));
+    return Semaphore(device, semaphore, pipelineStageFlag);
+}
+
+} // namespace
+
+SemaphorePool::SemaphorePool(const Device &device, uint32_t initialSemaphoreCount)
+    : device_(VkDevice(device))
+{
+    assert(device_);
+    free_.reserve(initialSemaphoreCount);
+    for (uint32_t i = 0; i < initialSemaphoreCount; ++i)
+    {
+        free_.emplace_back(CreatePooledSemaphore(device_, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT));
+    }
+}
+
+Semaphore SemaphorePool::Acquire(VkPipelineStageFlags pipelineStageFlag)
+{
+    assert(device_);
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (free_.empty())
+    {
+        lock.unlock();
+        return CreatePooledSemaphore(device_, pipelineStageFlag);
+    }
+
+    auto semaphore = std::move(free_.back());
+    free_.pop_back();
+    lock.unlock();
+
+    semaphore.SetPipeLineStageFlag(pipelineStageFlag);
+    return semaphore;
+}
+
+void SemaphorePool::Release(Semaphore &&semaphore)
+{
+    assert(semaphore);
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.emplace_back(std::move(semaphore));
+}
+
+} // namespace vkw
@@ -0,0 +1,292 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include <algorithm>
+
+#include "Serialization.h"
+
+namespace vkw
+{
+
+namespace
+{
+
+template <typename T>
+bool Contains(const std::vector<T> &values, T value)
+{
+    return std::find(values.cbegin(), values.cend(), value) != values.cend();
+}
+
+} // namespace
+
+uint64_t Fnv1a(const void *pData, size_t size)
+{
+    const auto *pBytes = static_cast<const uint8_t*>(pData);
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ pBytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool AppendGraphicsPipelineState(std::string &data, const GraphicsPipelineStateDescription &state, VkGraphicsPipelineLibraryFlagsEXT parts)
+{
+    const bool vertexInput = (parts & VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT) != 0;
+    const bool preRasterization = (parts & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT) != 0;
+    const bool fragmentShader = (parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT) != 0;
+    const bool fragmentOutput = (parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT) != 0;
+
+    std::vector<VkDynamicState> dynamicStates;
+    AppendBytes(data, state.dynamicState != nullptr);
+    if (state.dynamicState != nullptr)
+    {
+        if (state.dynamicState->pNext != nullptr)
+        {
+            return false;
+        }
+        dynamicStates = state.dynamicState->dynamicStates;
+        std::sort(dynamicStates.begin(), dynamicStates.end());
+        dynamicStates.erase(std::unique(dynamicStates.begin(), dynamicStates.end()), dynamicStates.end());
+        AppendBytes(data, state.dynamicState->flags);
+        AppendArray(data, dynamicStates);
+    }
+    const auto isDynamic = [&](VkDynamicState dynamicState)
+    {
+        return Contains(dynamicStates, dynamicState);
+    };
+
+    if (vertexInput)
+    {
+        const auto &vertexInputState = state.vertexInputState;
+        const auto &inputAssemblyState = state.inputAssemblyState;
+        if (vertexInputState.pNext != nullptr || inputAssemblyState.pNext != nullptr)
+        {
+            return false;
+        }
+        AppendBytes(data, vertexInputState.flags);
+        AppendArray(data, vertexInputState.vertexBindingDescriptions);
+        AppendArray(data, vertexInputState.vertexAttributeDescriptions);
+
+        AppendBytes(data, inputAssemblyState.flags);
+        AppendBytes(data, inputAssemblyState.topology);
+        AppendBytes(data, inputAssemblyState.primitiveRestartEnable);
+    }
+
+    if (preRasterization)
+    {
+        AppendBytes(data, state.tessellationState != nullptr);
+        if (state.tessellationState != nullptr)
+        {
+            if (state.tessellationState->pNext != nullptr)
+            {
+                return false;
+            }
+            AppendBytes(data, state.tessellationState->flags);
+            AppendBytes(data, state.tessellationState->patchControlPoints);
+        }
+
+        AppendBytes(data, state.viewportState != nullptr);
+        if (state.viewportState != nullptr)
+        {
+            const auto &viewportState = *state.viewportState;
+            if (viewportState.pNext != nullptr)
+            {
+                return false;
+            }
+            AppendBytes(data, viewportState.flags);
+            // only the counts of dynamic viewports and scissors, nothing if the count is dynamic as well
+            if (isDynamic(VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT_EXT))
+            {
+                AppendBytes(data, uint32_t(0));
+            }
+            else if (isDynamic(VK_DYNAMIC_STATE_VIEWPORT))
+            {
+                AppendBytes(data, static_cast<uint32_t>(viewportState.viewports.size()));
+            }
+            else
+            {
+                AppendArray(data, viewportState.viewports);
+            }
+            if (isDynamic(VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT_EXT))
+            {
+                AppendBytes(data, uint32_t(0));
+            }
+            else if (isDynamic(VK_DYNAMIC_STATE_SCISSOR))
+            {
+                AppendBytes(data, static_cast<uint32_t>(viewportState.scissors.size()));
+            }
+            else
+            {
+                AppendArray(data, viewportState.scissors);
+            }
+        }
+
+        const auto &rasterizationState = state.rasterizationState;
+        if (rasterizationState.pNext != nullptr)
+        {
+            return false;
+        }
+        AppendBytes(data, rasterizationState.flags);
+        AppendBytes(data, rasterizationState.depthClampEnable);
+        AppendBytes(data, rasterizationState.rasterizerDiscardEnable);
+        AppendBytes(data, rasterizationState.polygonMode);
+        // dynamic values are written as zero so the layout stays the same
+        AppendBytes(data, isDynamic(VK_DYNAMIC_STATE_CULL_MODE_EXT) ? VkCullModeFlags(0) : rasterizationState.cullMode);
+        AppendBytes(data, isDynamic(VK_DYNAMIC_STATE_FRONT_FACE_EXT) ? VkFrontFace(0) : rasterizationState.frontFace);
+        AppendBytes(data, rasterizationState.depthBiasEnable);
+        if (rasterizationState.depthBiasEnable && !isDynamic(VK_DYNAMIC_STATE_DEPTH_BIAS))
+        {
+            AppendBytes(data, rasterizationState.depthBiasConstantFactor);
+            AppendBytes(data, rasterizationState.depthBiasClamp);
+            AppendBytes(data, rasterizationState.depthBiasSlopeFactor);
+        }
+        if (!isDynamic(VK_DYNAMIC_STATE_LINE_WIDTH))
+        {
+            AppendBytes(data, rasterizationState.lineWidth);
+        }
+    }
+
+    if (fragmentShader || fragmentOutput)
+    {
+        AppendBytes(data, state.multisampleState != nullptr);
+        if (state.multisampleState != nullptr)
+        {
+            const auto &multisampleState = *state.multisampleState;
+            if (multisampleState.pNext != nullptr)
+            {
+                return false;
+            }
+            AppendBytes(data, multisampleState.flags);
+            AppendBytes(data, multisampleState.rasterizationSamples);
+            AppendBytes(data, multisampleState.sampleShadingEnable);
+            AppendBytes(data, multisampleState.minSampleShading);
+            // empty without a sample mask
+            const auto sampleMaskCount = multisampleState.pSampleMask != nullptr ? (static_cast<uint32_t>(multisampleState.rasterizationSamples) + 31) / 32 : 0;
+            AppendArray(data, multisampleState.pSampleMask, sampleMaskCount);
+            AppendBytes(data, multisampleState.alphaToCoverageEnable);
+            AppendBytes(data, multisampleState.alphaToOneEnable);
+        }
+    }
+
+    if (fragmentShader)
+    {
+        AppendBytes(data, state.depthStencilState != nullptr);
+        if (state.depthStencilState != nullptr)
+        {
+            const auto &depthStencilState = *state.depthStencilState;
+            if (depthStencilState.pNext != nullptr)
+            {
+                return false;
+            }
+            // dynamic values are written as zero so the layout stays the same
+            const auto stencilOpState = [&](VkStencilOpState opState)
+            {
+                if (isDynamic(VK_DYNAMIC_STATE_STENCIL_OP_EXT))
+                {
+                    opState.failOp = VkStencilOp(0);
+                    opState.passOp = VkStencilOp(0);
+                    opState.depthFailOp = VkStencilOp(0);
+                    opState.compareOp = VkCompareOp(0);
+                }
+                opState.compareMask = isDynamic(VK_DYNAMIC_STATE_STENCIL_COMPARE_MASK) ? 0 : opState.compareMask;
+                opState.writeMask = isDynamic(VK_DYNAMIC_STATE_STENCIL_WRITE_MASK) ? 0 : opState.writeMask;
+                opState.reference = isDynamic(VK_DYNAMIC_STATE_STENCIL_REFERENCE) ? 0 : opState.reference;
+                return opState;
+            };
+            const VkBool32 depthBoundsTestEnable = isDynamic(VK_DYNAMIC_STATE_DEPTH_BOUNDS_TEST_ENABLE_EXT) ? VK_FALSE : depthStencilState.depthBoundsTestEnable;
+            AppendBytes(data, depthStencilState.flags);
+            AppendBytes(data, isDynamic(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT) ? VK_FALSE : depthStencilState.depthTestEnable);
+            AppendBytes(data, isDynamic(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT) ? VK_FALSE : depthStencilState.depthWriteEnable);
+            AppendBytes(data, isDynamic(VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT) ? VkCompareOp(0) : depthStencilState.depthCompareOp);
+            AppendBytes(data, depthBoundsTestEnable);
+            AppendBytes(data, isDynamic(VK_DYNAMIC_STATE_STENCIL_TEST_ENABLE_EXT) ? VK_FALSE : depthStencilState.stencilTestEnable);
+            AppendBytes(data, stencilOpState(depthStencilState.front));
+            AppendBytes(data, stencilOpState(depthStencilState.back));
+            // the bounds are used if the test can be enabled at draw time
+            if ((depthBoundsTestEnable || isDynamic(VK_DYNAMIC_STATE_DEPTH_BOUNDS_TEST_ENABLE_EXT)) && !isDynamic(VK_DYNAMIC_STATE_DEPTH_BOUNDS))
+            {
+                AppendBytes(data, depthStencilState.minDepthBounds);
+                AppendBytes(data, depthStencilState.maxDepthBounds);
+            }
+        }
+    }
+
+    if (fragmentOutput)
+    {
+        AppendBytes(data, state.colorBlendState != nullptr);
+        if (state.colorBlendState != nullptr)
+        {
+            const auto &colorBlendState = *state.colorBlendState;
+            if (colorBlendState.pNext != nullptr)
+            {
+                return false;
+            }
+            AppendBytes(data, colorBlendState.flags);
+            AppendBytes(data, colorBlendState.logicOpEnable);
+            if (colorBlendState.logicOpEnable)
+            {
+                AppendBytes(data, colorBlendState.logicOp);
+            }
+            AppendArray(data, colorBlendState.attachments);
+            if (!isDynamic(VK_DYNAMIC_STATE_BLEND_CONSTANTS))
+            {
+                AppendBytes(data, colorBlendState.blendConstants);
+            }
+        }
+    }
+
+    return true;
+}
+
+bool AppendShaderStage(std::string &data, const Pipeline::ShaderStage &stage)
+{
+    if (stage.pNext != nullptr)
+    {
+        return false;
+    }
+
+    AppendBytes(data, stage.flags);
+    AppendBytes(data, stage.stage);
+    AppendArray(data, stage.entryPointName.data(), stage.entryPointName.size());
+
+    const auto pSpecializationInfo = stage.pSpecializationInfo;
+    AppendBytes(data, pSpecializationInfo != nullptr);
+    if (pSpecializationInfo != nullptr)
+    {
+        // the size of the map entries is written as uint32_t, so there are no padding bytes
+        AppendBytes(data, pSpecializationInfo->mapEntryCount);
+        for (uint32_t i = 0; i < pSpecializationInfo->mapEntryCount; ++i)
+        {
+            const auto &mapEntry = pSpecializationInfo->pMapEntries[i];
+            AppendBytes(data, mapEntry.constantID);
+            AppendBytes(data, mapEntry.offset);
+            AppendBytes(data, static_cast<uint32_t>(mapEntry.size));
+        }
+        AppendArray(data, static_cast<const uint8_t*>(pSpecializationInfo->pData), pSpecializationInfo->dataSize);
+    }
+    return true;
+}
+
+} // namespace vkw
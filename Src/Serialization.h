@@ -0,0 +1,72 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "VulkanWrapper.h"
+
+namespace vkw
+{
+
+// Byte serialization shared by the pipeline keys, the object caches of the device and PipelineManifest
+
+template <typename T>
+void AppendBytes(std::string &data, const T &value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable!");
+    data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// the count is written as uint32_t
+template <typename T>
+void AppendArray(std::string &data, const T *pValues, size_t count)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable!");
+    AppendBytes(data, static_cast<uint32_t>(count));
+    if (count > 0)
+    {
+        data.append(reinterpret_cast<const char*>(pValues), sizeof(T) * count);
+    }
+}
+
+template <typename T>
+void AppendArray(std::string &data, const std::vector<T> &values)
+{
+    AppendArray(data, values.data(), values.size());
+}
+
+// 64 bit FNV-1a
+uint64_t Fnv1a(const void *pData, size_t size);
+
+// Canonical form of the state which belongs to the given parts of a graphics pipeline, see VK_EXT_graphics_pipeline_library.
+// The dynamic states come first, values of state which is dynamic are left out.
+// Returns false if one of the states has a pNext chain.
+bool AppendGraphicsPipelineState(std::string &data, const GraphicsPipelineStateDescription &state, VkGraphicsPipelineLibraryFlagsEXT parts);
+
+// everything but the module, which the caller identifies. Returns false if the stage has a pNext chain
+bool AppendShaderStage(std::string &data, const Pipeline::ShaderStage &stage);
+
+} // namespace vkw
@@ -0,0 +1,138 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include <algorithm>
+
+#include "Error.h"
+#include "MappedFile.h"
+#include "Serialization.h"
+
+namespace vkw
+{
+
+ShaderLibrary::ShaderLibrary(const Device &device)
+    : device_(std::make_shared<const Device>(device.GetView()))
+{
+    assert(device);
+}
+
+std::shared_ptr<const ShaderModule> ShaderLibrary::Load(const std::string &path)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto pathIt = paths_.find(path);
+        if (pathIt != paths_.end())
+        {
+            const auto it = modules_.find(pathIt->second);
+            if (it != modules_.end())
+            {
+                return it->second.module;
+            }
+        }
+    }
+
+    const MappedFile file(path);
+    if (!file || file.Size() % sizeof(uint32_t) != 0)
+    {
+        return nullptr;
+    }
+
+    const Span<uint32_t> code(reinterpret_cast<const uint32_t*>(file.Data()), file.Size() / sizeof(uint32_t));
+    const auto hash = Hash(code);
+    auto module = Get(hash, code);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    paths_[path] = hash;
+    return module;
+}
+
+std::shared_ptr<const ShaderModule> ShaderLibrary::Get(const Span<uint32_t> &code)
+{
+    assert(code);
+    return Get(Hash(code), code);
+}
+
+std::shared_ptr<const ShaderModule> ShaderLibrary::Get(uint64_t hash, const Span<uint32_t> &code)
+{
+    const auto isEqual = [&](const Entry &entry)
+    {
+        return entry.code.size() == code.Count() && std::equal(entry.code.begin(), entry.code.end(), code.Data());
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = modules_.find(hash);
+        if (it != modules_.end() && isEqual(it->second))
+        {
+            return it->second.module;
+        }
+    }
+
+    // created outside of the lock, if another thread has been faster its module wins
+    auto module = std::make_shared<const ShaderModule>(device_->CreateShaderModule(code));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = modules_.find(hash);
+    if (it == modules_.end())
+    {
+        Entry entry = {std::vector<uint32_t>(code.begin(), code.end()), std::move(module)};
+        return modules_.emplace(hash, std::move(entry)).first->second.module;
+    }
+    // a different module with the same hash keeps the slot, this one is not shared
+    return isEqual(it->second) ? it->second.module : module;
+}
+
+std::shared_ptr<const ShaderModule> ShaderLibrary::Find(uint64_t hash) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = modules_.find(hash);
+    return it != modules_.end() ? it->second.module : nullptr;
+}
+
+void ShaderLibrary::ReleaseUnused()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (auto it = modules_.begin(); it != modules_.end();)
+    {
+        it = it->second.module.use_count() == 1 ? modules_.erase(it) : std::next(it);
+    }
+    for (auto it = paths_.begin(); it != paths_.end();)
+    {
+        it = modules_.count(it->second) == 0 ? paths_.erase(it) : std::next(it);
+    }
+}
+
+uint64_t ShaderLibrary::Hash(const Span<uint32_t> &code)
+{
+    return Fnv1a(code.Data(), sizeof(uint32_t) * code.Count());
+}
+
+size_t ShaderLibrary::GetSize() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return modules_.size();
+}
+
+} // namespace vkw
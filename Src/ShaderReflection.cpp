@@ -0,0 +1,810 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include <algorithm>
+
+#include "Error.h"
+
+namespace vkw
+{
+
+namespace
+{
+
+// the parts of the SPIR-V grammar which take part in the reflection
+enum Op : uint32_t
+{
+    OpEntryPoint = 15,
+    OpExecutionMode = 16,
+    OpTypeBool = 20,
+    OpTypeInt = 21,
+    OpTypeFloat = 22,
+    OpTypeVector = 23,
+    OpTypeMatrix = 24,
+    OpTypeImage = 25,
+    OpTypeSampler = 26,
+    OpTypeSampledImage = 27,
+    OpTypeArray = 28,
+    OpTypeRuntimeArray = 29,
+    OpTypeStruct = 30,
+    OpTypePointer = 32,
+    OpConstantTrue = 41,
+    OpConstantFalse = 42,
+    OpConstant = 43,
+    OpConstantComposite = 44,
+    OpSpecConstantTrue = 48,
+    OpSpecConstantFalse = 49,
+    OpSpecConstant = 50,
+    OpSpecConstantComposite = 51,
+    OpFunction = 54,
+    OpVariable = 59,
+    OpDecorate = 71,
+    OpMemberDecorate = 72,
+    OpDecorationGroup = 73,
+    OpGroupDecorate = 74,
+    OpGroupMemberDecorate = 75,
+    OpExecutionModeId = 331,
+    OpDecorateId = 332,
+    OpDecorateString = 5632,
+    OpMemberDecorateString = 5633,
+};
+
+enum Decoration : uint32_t
+{
+    DecorationSpecId = 1,
+    DecorationBlock = 2,
+    DecorationBufferBlock = 3,
+    DecorationRowMajor = 4,
+    DecorationArrayStride = 6,
+    DecorationMatrixStride = 7,
+    DecorationBuiltIn = 11,
+    DecorationLocation = 30,
+    DecorationBinding = 33,
+    DecorationDescriptorSet = 34,
+    DecorationOffset = 35,
+};
+
+enum StorageClass : uint32_t
+{
+    StorageClassUniformConstant = 0,
+    StorageClassInput = 1,
+    StorageClassUniform = 2,
+    StorageClassPushConstant = 9,
+    StorageClassStorageBuffer = 12,
+};
+
+constexpr uint32_t MAGIC_NUMBER = 0x07230203;
+constexpr uint32_t HEADER_WORD_COUNT = 5;
+constexpr uint32_t EXECUTION_MODE_LOCAL_SIZE = 17;
+constexpr uint32_t EXECUTION_MODE_LOCAL_SIZE_ID = 38;
+constexpr uint32_t BUILT_IN_WORKGROUP_SIZE = 25;
+constexpr uint32_t DIM_BUFFER = 5;
+constexpr uint32_t DIM_SUBPASS_DATA = 6;
+
+// the smallest word count of the instructions which take part, so their operands can be read without further checks
+uint32_t GetMinWordCount(uint32_t opcode)
+{
+    switch (opcode)
+    {
+    case OpTypeBool:
+    case OpTypeSampler:
+    case OpTypeStruct:
+        return 2;
+    case OpExecutionMode:
+    case OpExecutionModeId:
+    case OpTypeFloat:
+    case OpTypeSampledImage:
+    case OpTypeRuntimeArray:
+    case OpConstantTrue:
+    case OpConstantFalse:
+    case OpConstantComposite:
+    case OpSpecConstantTrue:
+    case OpSpecConstantFalse:
+    case OpSpecConstantComposite:
+    case OpDecorate:
+        return 3;
+    case OpEntryPoint:
+    case OpTypeInt:
+    case OpTypeVector:
+    case OpTypeMatrix:
+    case OpTypeArray:
+    case OpTypePointer:
+    case OpConstant:
+    case OpSpecConstant:
+    case OpVariable:
+    case OpMemberDecorate:
+        return 4;
+    case OpTypeImage:
+        return 9;
+    default:
+        return 1;
+    }
+}
+
+constexpr VkShaderStageFlagBits EXECUTION_MODEL_STAGES[] = {VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,
+                                                            VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT, VK_SHADER_STAGE_GEOMETRY_BIT,
+                                                            VK_SHADER_STAGE_FRAGMENT_BIT, VK_SHADER_STAGE_COMPUTE_BIT};
+
+// what the reflection needs to know about an id, everything else is read from the defining instruction
+struct Id
+{
+    enum Flags : uint32_t
+    {
+        HAS_SET = 0x1,
+        HAS_BINDING = 0x2,
+        HAS_LOCATION = 0x4,
+        HAS_SPEC_ID = 0x8,
+        IS_BUFFER_BLOCK = 0x10,
+        IS_BUILT_IN = 0x20,
+    };
+
+    // word offset of the defining instruction, 0 if the id has not been defined
+    uint32_t position = 0;
+    uint32_t flags = 0;
+    uint32_t set = 0;
+    uint32_t binding = 0;
+    uint32_t location = 0;
+    uint32_t specId = 0;
+    uint32_t arrayStride = 0;
+    uint32_t builtIn = 0;
+    // word offset of the first OpMemberDecorate of a struct
+    uint32_t memberDecorations = 0;
+};
+
+class Module
+{
+public:
+
+    Module(const uint32_t *pCode, uint32_t bound)
+        : pCode_(pCode), ids_(bound) {}
+
+    Id* Find(uint32_t id)
+    {
+        return id < ids_.size() ? &ids_[id] : nullptr;
+    }
+
+    // The defining instruction if it comes before the given position, otherwise a single word with opcode 0, so callers
+    // check the opcode before reading operands. Types only follow earlier definitions, so they cannot form cycles.
+    const uint32_t* Get(uint32_t id, uint32_t before = UINT32_MAX) const
+    {
+        static const uint32_t undefined[1] = {};
+        return id < ids_.size() && ids_[id].position != 0 && ids_[id].position < before ? pCode_ + ids_[id].position : undefined;
+    }
+
+    uint32_t Position(const uint32_t *pInstruction) const
+    {
+        return static_cast<uint32_t>(pInstruction - pCode_);
+    }
+
+    const Id& Info(uint32_t id) const
+    {
+        static const Id undefined;
+        return id < ids_.size() ? ids_[id] : undefined;
+    }
+
+    static uint32_t Opcode(const uint32_t *pInstruction)
+    {
+        return pInstruction[0] & 0xFFFF;
+    }
+
+    static uint32_t WordCount(const uint32_t *pInstruction)
+    {
+        return pInstruction[0] >> 16;
+    }
+
+    uint64_t ConstantValue(uint32_t id) const
+    {
+        const auto pInstruction = Get(id);
+        switch (Opcode(pInstruction))
+        {
+        case OpConstantTrue:
+        case OpSpecConstantTrue:
+            return 1;
+        case OpConstant:
+        case OpSpecConstant:
+            return WordCount(pInstruction) > 4 ? pInstruction[3] | static_cast<uint64_t>(pInstruction[4]) << 32 : pInstruction[3];
+        default:
+            return 0;
+        }
+    }
+
+    uint32_t TypeSize(uint32_t typeId, uint32_t before = UINT32_MAX) const
+    {
+        const auto pType = Get(typeId, before);
+        switch (Opcode(pType))
+        {
+        case OpTypeBool:
+            return sizeof(VkBool32);
+        case OpTypeInt:
+        case OpTypeFloat:
+            return pType[2] / 8;
+        case OpTypeVector:
+        case OpTypeMatrix:
+            return pType[3] * TypeSize(pType[2], Position(pType));
+        case OpTypeArray:
+        {
+            const auto length = static_cast<uint32_t>(ConstantValue(pType[3]));
+            const auto arrayStride = Info(typeId).arrayStride;
+            return length * (arrayStride != 0 ? arrayStride : TypeSize(pType[2], Position(pType)));
+        }
+        case OpTypeStruct:
+        {
+            uint32_t begin, end;
+            StructRange(typeId, begin, end, before);
+            return end;
+        }
+        default:
+            return 0;
+        }
+    }
+
+    // the bytes covered by the members of a struct
+    void StructRange(uint32_t structId, uint32_t &begin, uint32_t &end, uint32_t before = UINT32_MAX) const
+    {
+        const auto pStruct = Get(structId, before);
+        const auto memberCount = Opcode(pStruct) == OpTypeStruct ? WordCount(pStruct) - 2 : 0;
+        begin = memberCount > 0 ? UINT32_MAX : 0;
+        end = 0;
+        for (uint32_t member = 0; member < memberCount; ++member)
+        {
+            const auto memberTypeId = pStruct[2 + member];
+            const auto pMemberType = Get(memberTypeId, Position(pStruct));
+
+            uint32_t offset = 0;
+            MemberDecoration(structId, member, DecorationOffset, &offset);
+
+            auto size = TypeSize(memberTypeId, Position(pStruct));
+            uint32_t matrixStride = 0;
+            if (Opcode(pMemberType) == OpTypeMatrix && MemberDecoration(structId, member, DecorationMatrixStride, &matrixStride))
+            {
+                const auto pColumnType = Get(pMemberType[2], Position(pMemberType));
+                const auto rowCount = Opcode(pColumnType) == OpTypeVector ? pColumnType[3] : 0;
+                size = (MemberDecoration(structId, member, DecorationRowMajor, nullptr) ? rowCount : pMemberType[3]) * matrixStride;
+            }
+
+            begin = std::min(begin, offset);
+            end = std::max(end, offset + size);
+        }
+    }
+
+    // the annotations form one section of the module, the member decorations of a struct start at its first one
+    bool MemberDecoration(uint32_t structId, uint32_t member, uint32_t decoration, uint32_t *pValue) const
+    {
+        const auto position = Info(structId).memberDecorations;
+        if (position == 0)
+        {
+            return false;
+        }
+
+        for (auto pInstruction = pCode_ + position; IsAnnotation(Opcode(pInstruction)); pInstruction += WordCount(pInstruction))
+        {
+            if (Opcode(pInstruction) == OpMemberDecorate && pInstruction[1] == structId && pInstruction[2] == member && pInstruction[3] == decoration)
+            {
+                if (pValue != nullptr)
+                {
+                    *pValue = WordCount(pInstruction) > 4 ? pInstruction[4] : 0;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool IsAnnotation(uint32_t opcode)
+    {
+        return (opcode >= OpDecorate && opcode <= OpGroupMemberDecorate) || opcode == OpDecorateId ||
+               opcode == OpDecorateString || opcode == OpMemberDecorateString;
+    }
+
+private:
+
+    const uint32_t *pCode_;
+    std::vector<Id> ids_;
+}; // class Module
+
+VkFormat GetVertexFormat(const uint32_t *pComponentType, uint32_t componentCount)
+{
+    static const VkFormat floatFormats[] = {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+    static const VkFormat doubleFormats[] = {VK_FORMAT_R64_SFLOAT, VK_FORMAT_R64G64_SFLOAT, VK_FORMAT_R64G64B64_SFLOAT, VK_FORMAT_R64G64B64A64_SFLOAT};
+    static const VkFormat intFormats[] = {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+    static const VkFormat uintFormats[] = {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+
+    if (componentCount < 1 || componentCount > 4)
+    {
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    if (Module::Opcode(pComponentType) == OpTypeFloat)
+    {
+        const auto width = pComponentType[2];
+        return width == 32 ? floatFormats[componentCount - 1] : width == 64 ? doubleFormats[componentCount - 1] : VK_FORMAT_UNDEFINED;
+    }
+    if (Module::Opcode(pComponentType) == OpTypeInt && pComponentType[2] == 32)
+    {
+        return pComponentType[3] != 0 ? intFormats[componentCount - 1] : uintFormats[componentCount - 1];
+    }
+    return VK_FORMAT_UNDEFINED;
+}
+
+uint32_t GetFormatSize(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_R32_SINT:
+    case VK_FORMAT_R32_UINT:
+        return 4;
+    case VK_FORMAT_R32G32_SFLOAT:
+    case VK_FORMAT_R32G32_SINT:
+    case VK_FORMAT_R32G32_UINT:
+    case VK_FORMAT_R64_SFLOAT:
+        return 8;
+    case VK_FORMAT_R32G32B32_SFLOAT:
+    case VK_FORMAT_R32G32B32_SINT:
+    case VK_FORMAT_R32G32B32_UINT:
+        return 12;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+    case VK_FORMAT_R32G32B32A32_SINT:
+    case VK_FORMAT_R32G32B32A32_UINT:
+    case VK_FORMAT_R64G64_SFLOAT:
+        return 16;
+    case VK_FORMAT_R64G64B64_SFLOAT:
+        return 24;
+    case VK_FORMAT_R64G64B64A64_SFLOAT:
+        return 32;
+    default:
+        return 0;
+    }
+}
+
+// returns the location after the input, 64 bit vectors with more than two components take two locations
+uint32_t AddVertexInputs(const Module &module, uint32_t typeId, uint32_t location, std::vector<ShaderReflection::VertexInput> &vertexInputs,
+                         uint32_t before = UINT32_MAX)
+{
+    const auto pType = module.Get(typeId, before);
+    switch (Module::Opcode(pType))
+    {
+    case OpTypeArray:
+    {
+        const auto length = module.ConstantValue(pType[3]);
+        for (uint64_t i = 0; i < length; ++i)
+        {
+            location = AddVertexInputs(module, pType[2], location, vertexInputs, module.Position(pType));
+        }
+        return location;
+    }
+    case OpTypeMatrix:
+        for (uint32_t column = 0; column < pType[3]; ++column)
+        {
+            location = AddVertexInputs(module, pType[2], location, vertexInputs, module.Position(pType));
+        }
+        return location;
+    case OpTypeVector:
+    {
+        const auto format = GetVertexFormat(module.Get(pType[2], module.Position(pType)), pType[3]);
+        vertexInputs.push_back({location, format});
+        return location + (GetFormatSize(format) > 16 ? 2 : 1);
+    }
+    default:
+        vertexInputs.push_back({location, GetVertexFormat(pType, 1)});
+        return location + 1;
+    }
+}
+
+bool GetDescriptorType(const Module &module, const uint32_t *pType, uint32_t storageClass, uint32_t typeFlags, VkDescriptorType &descriptorType)
+{
+    switch (Module::Opcode(pType))
+    {
+    case OpTypeSampler:
+        descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        return true;
+    case OpTypeSampledImage:
+    {
+        const auto pImageType = module.Get(pType[2], module.Position(pType));
+        descriptorType = Module::Opcode(pImageType) == OpTypeImage && pImageType[3] == DIM_BUFFER
+                         ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        return true;
+    }
+    case OpTypeImage:
+    {
+        // Sampled is 1 for images used with a sampler and 2 for storage images
+        const auto dim = pType[3];
+        const auto storage = pType[7] == 2;
+        if (dim == DIM_BUFFER)
+        {
+            descriptorType = storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+        }
+        else if (dim == DIM_SUBPASS_DATA)
+        {
+            descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        }
+        else
+        {
+            descriptorType = storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        }
+        return true;
+    }
+    case OpTypeStruct:
+        descriptorType = storageClass == StorageClassStorageBuffer || (typeFlags & Id::IS_BUFFER_BLOCK) != 0
+                         ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+ShaderReflection::ShaderReflection(const Span<uint32_t> &code)
+{
+    const auto pCode = code.Data();
+    const auto wordCount = code.Count();
+    if (pCode == nullptr || wordCount < HEADER_WORD_COUNT || pCode[0] != MAGIC_NUMBER)
+    {
+        return;
+    }
+
+    // the only allocation besides the results, one entry per id of the module. Every id is defined by an instruction
+    // of at least two words, so a bound beyond the word count is not trusted
+    Module module(pCode, std::min(pCode[3], wordCount));
+    VkShaderStageFlags stage = 0;
+    uint32_t entryPoint = 0;
+    uint32_t localSizeIds[3] = {};
+
+    // the logical layout of a module puts entry points, execution modes, annotations, types,
+    // constants and global variables in that order, so everything an instruction refers to is known when it is reached
+    auto position = HEADER_WORD_COUNT;
+    while (position < wordCount)
+    {
+        const auto pInstruction = pCode + position;
+        const auto opcode = Module::Opcode(pInstruction);
+        const auto instructionWordCount = Module::WordCount(pInstruction);
+        if (instructionWordCount < GetMinWordCount(opcode) || position + instructionWordCount > wordCount)
+        {
+            return;
+        }
+        if (opcode == OpFunction)
+        {
+            break;
+        }
+
+        switch (opcode)
+        {
+        case OpEntryPoint:
+            if (stage == 0 && pInstruction[1] < sizeof(EXECUTION_MODEL_STAGES) / sizeof(EXECUTION_MODEL_STAGES[0]))
+            {
+                stage = EXECUTION_MODEL_STAGES[pInstruction[1]];
+                entryPoint = pInstruction[2];
+            }
+            break;
+        case OpExecutionMode:
+            if (instructionWordCount >= 6 && pInstruction[1] == entryPoint && pInstruction[2] == EXECUTION_MODE_LOCAL_SIZE)
+            {
+                workgroupSize_ = {pInstruction[3], pInstruction[4], pInstruction[5]};
+            }
+            break;
+        case OpExecutionModeId:
+            // the constants are defined later in the module
+            if (instructionWordCount >= 6 && pInstruction[1] == entryPoint && pInstruction[2] == EXECUTION_MODE_LOCAL_SIZE_ID)
+            {
+                std::copy(pInstruction + 3, pInstruction + 6, localSizeIds);
+            }
+            break;
+        case OpDecorate:
+        {
+            auto id = module.Find(pInstruction[1]);
+            if (id == nullptr)
+            {
+                break;
+            }
+            const auto literal = instructionWordCount > 3 ? pInstruction[3] : 0;
+            switch (pInstruction[2])
+            {
+            case DecorationSpecId: id->specId = literal; id->flags |= Id::HAS_SPEC_ID; break;
+            case DecorationBufferBlock: id->flags |= Id::IS_BUFFER_BLOCK; break;
+            case DecorationArrayStride: id->arrayStride = literal; break;
+            case DecorationBuiltIn: id->builtIn = literal; id->flags |= Id::IS_BUILT_IN; break;
+            case DecorationLocation: id->location = literal; id->flags |= Id::HAS_LOCATION; break;
+            case DecorationBinding: id->binding = literal; id->flags |= Id::HAS_BINDING; break;
+            case DecorationDescriptorSet: id->set = literal; id->flags |= Id::HAS_SET; break;
+            default: break;
+            }
+            break;
+        }
+        case OpMemberDecorate:
+        {
+            auto id = module.Find(pInstruction[1]);
+            if (id != nullptr && id->memberDecorations == 0)
+            {
+                id->memberDecorations = position;
+            }
+            break;
+        }
+        case OpTypeBool:
+        case OpTypeInt:
+        case OpTypeFloat:
+        case OpTypeVector:
+        case OpTypeMatrix:
+        case OpTypeImage:
+        case OpTypeSampler:
+        case OpTypeSampledImage:
+        case OpTypeArray:
+        case OpTypeRuntimeArray:
+        case OpTypeStruct:
+        case OpTypePointer:
+        {
+            auto id = module.Find(pInstruction[1]);
+            if (id != nullptr)
+            {
+                id->position = position;
+            }
+            break;
+        }
+        case OpConstantTrue:
+        case OpConstantFalse:
+        case OpConstant:
+        case OpConstantComposite:
+        case OpSpecConstantTrue:
+        case OpSpecConstantFalse:
+        case OpSpecConstant:
+        case OpSpecConstantComposite:
+        {
+            auto id = module.Find(pInstruction[2]);
+            if (id == nullptr)
+            {
+                break;
+            }
+            id->position = position;
+
+            if ((id->flags & Id::HAS_SPEC_ID) != 0 && opcode != OpSpecConstantComposite)
+            {
+                specializationConstants_.push_back({id->specId, module.TypeSize(pInstruction[1]), module.ConstantValue(pInstruction[2])});
+            }
+            if ((id->flags & Id::IS_BUILT_IN) != 0 && id->builtIn == BUILT_IN_WORKGROUP_SIZE && instructionWordCount >= 6)
+            {
+                for (uint32_t i = 0; i < 3; ++i)
+                {
+                    workgroupSize_[i] = static_cast<uint32_t>(module.ConstantValue(pInstruction[3 + i]));
+                }
+            }
+            break;
+        }
+        case OpVariable:
+        {
+            const auto id = module.Info(pInstruction[2]);
+            const auto storageClass = pInstruction[3];
+            const auto pPointer = module.Get(pInstruction[1]);
+            if (Module::Opcode(pPointer) != OpTypePointer)
+            {
+                break;
+            }
+            auto typeId = pPointer[3];
+            uint32_t before = UINT32_MAX;
+
+            if (storageClass == StorageClassUniformConstant || storageClass == StorageClassUniform || storageClass == StorageClassStorageBuffer)
+            {
+                if ((id.flags & Id::HAS_BINDING) == 0)
+                {
+                    break;
+                }
+
+                uint32_t descriptorCount = 1;
+                for (;;)
+                {
+                    const auto pType = module.Get(typeId, before);
+                    if (Module::Opcode(pType) == OpTypeArray)
+                    {
+                        descriptorCount *= static_cast<uint32_t>(module.ConstantValue(pType[3]));
+                    }
+                    else if (Module::Opcode(pType) == OpTypeRuntimeArray)
+                    {
+                        descriptorCount = 0;
+                    }
+                    else
+                    {
+                        break;
+                    }
+                    typeId = pType[2];
+                    before = module.Position(pType);
+                }
+
+                VkDescriptorType descriptorType;
+                if (GetDescriptorType(module, module.Get(typeId, before), storageClass, module.Info(typeId).flags, descriptorType))
+                {
+                    if (id.set >= sets_.size())
+                    {
+                        sets_.resize(id.set + 1);
+                    }
+                    sets_[id.set].push_back({id.binding, descriptorType, descriptorCount, stage, nullptr});
+                }
+            }
+            else if (storageClass == StorageClassPushConstant)
+            {
+                uint32_t begin, end;
+                module.StructRange(typeId, begin, end);
+                if (end > begin)
+                {
+                    pushConstantRanges_.push_back({stage, begin, end - begin});
+                }
+            }
+            else if (storageClass == StorageClassInput && stage == VK_SHADER_STAGE_VERTEX_BIT &&
+                     (id.flags & Id::HAS_LOCATION) != 0 && (id.flags & Id::IS_BUILT_IN) == 0)
+            {
+                AddVertexInputs(module, typeId, id.location, vertexInputs_);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        position += instructionWordCount;
+    }
+
+    if (localSizeIds[0] != 0)
+    {
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            workgroupSize_[i] = static_cast<uint32_t>(module.ConstantValue(localSizeIds[i]));
+        }
+    }
+
+    for (auto &bindings : sets_)
+    {
+        std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding &a, const VkDescriptorSetLayoutBinding &b)
+        {
+            return a.binding < b.binding;
+        });
+    }
+    std::sort(specializationConstants_.begin(), specializationConstants_.end(), [](const SpecializationConstant &a, const SpecializationConstant &b)
+    {
+        return a.constantID < b.constantID;
+    });
+    std::sort(vertexInputs_.begin(), vertexInputs_.end(), [](const VertexInput &a, const VertexInput &b)
+    {
+        return a.location < b.location;
+    });
+
+    stages_ = stage;
+}
+
+ShaderReflection::ShaderReflection(const Span<char> &code)
+    : ShaderReflection(Span<uint32_t>(reinterpret_cast<const uint32_t*>(code.Data()), code.Size() / sizeof(uint32_t)))
+{}
+
+ShaderReflection& ShaderReflection::Merge(const ShaderReflection &other)
+{
+    stages_ |= other.stages_;
+
+    if (other.sets_.size() > sets_.size())
+    {
+        sets_.resize(other.sets_.size());
+    }
+    for (size_t set = 0; set < other.sets_.size(); ++set)
+    {
+        auto &bindings = sets_[set];
+        for (const auto &binding : other.sets_[set])
+        {
+            auto it = std::lower_bound(bindings.begin(), bindings.end(), binding, [](const VkDescriptorSetLayoutBinding &a, const VkDescriptorSetLayoutBinding &b)
+            {
+                return a.binding < b.binding;
+            });
+            if (it != bindings.end() && it->binding == binding.binding)
+            {
+                assert(it->descriptorType == binding.descriptorType);
+                it->stageFlags |= binding.stageFlags;
+                it->descriptorCount = std::max(it->descriptorCount, binding.descriptorCount);
+            }
+            else
+            {
+                bindings.insert(it, binding);
+            }
+        }
+    }
+
+    // every stage may only be part of one range, stages which use the same range share it
+    for (const auto &range : other.pushConstantRanges_)
+    {
+        auto it = std::find_if(pushConstantRanges_.begin(), pushConstantRanges_.end(), [&](const VkPushConstantRange &r)
+        {
+            return r.offset == range.offset && r.size == range.size;
+        });
+        if (it != pushConstantRanges_.end())
+        {
+            it->stageFlags |= range.stageFlags;
+        }
+        else
+        {
+            pushConstantRanges_.push_back(range);
+        }
+    }
+
+    for (const auto &constant : other.specializationConstants_)
+    {
+        auto it = std::lower_bound(specializationConstants_.begin(), specializationConstants_.end(), constant, [](const SpecializationConstant &a, const SpecializationConstant &b)
+        {
+            return a.constantID < b.constantID;
+        });
+        if (it == specializationConstants_.end() || it->constantID != constant.constantID)
+        {
+            specializationConstants_.insert(it, constant);
+        }
+    }
+
+    if ((other.stages_ & VK_SHADER_STAGE_VERTEX_BIT) != 0)
+    {
+        vertexInputs_ = other.vertexInputs_;
+    }
+    if ((other.stages_ & VK_SHADER_STAGE_COMPUTE_BIT) != 0)
+    {
+        workgroupSize_ = other.workgroupSize_;
+    }
+
+    return *this;
+}
+
+Pipeline::VertexInputState ShaderReflection::GetVertexInputState(uint32_t binding, VkVertexInputRate inputRate) const
+{
+    std::vector<VkVertexInputAttributeDescription> attributes;
+    attributes.reserve(vertexInputs_.size());
+
+    uint32_t offset = 0;
+    for (const auto &input : vertexInputs_)
+    {
+        assert(input.format != VK_FORMAT_UNDEFINED);
+        attributes.push_back({input.location, binding, input.format, offset});
+        offset += GetFormatSize(input.format);
+    }
+
+    if (attributes.empty())
+    {
+        return {};
+    }
+    return Pipeline::VertexInputState(VkVertexInputBindingDescription{binding, offset, inputRate}, attributes);
+}
+
+const DescriptorSetLayout& ShaderReflection::GetDescriptorSetLayout(const Device &device, uint32_t set) const
+{
+    if (set >= sets_.size() || sets_[set].empty())
+    {
+        return device.GetDescriptorSetLayout(Span<VkDescriptorSetLayoutBinding>());
+    }
+    assert(std::none_of(sets_[set].begin(), sets_[set].end(), [](const auto &binding) { return binding.descriptorCount == 0; }));
+    return device.GetDescriptorSetLayout(sets_[set]);
+}
+
+const PipelineLayout& ShaderReflection::GetPipelineLayout(const Device &device) const
+{
+    std::vector<const DescriptorSetLayout*> setLayouts;
+    setLayouts.reserve(sets_.size());
+    for (uint32_t set = 0; set < static_cast<uint32_t>(sets_.size()); ++set)
+    {
+        setLayouts.push_back(&GetDescriptorSetLayout(device, set));
+    }
+
+    return device.GetPipelineLayout(Span2<DescriptorSetLayout>(setLayouts.data(), setLayouts.size()),
+                                    pushConstantRanges_.empty() ? Span<VkPushConstantRange>() : Span<VkPushConstantRange>(pushConstantRanges_));
+}
+
+} // namespace vkw
@@ -0,0 +1,103 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "VulkanWrapper.h"
+
+namespace vkw
+{
+
+inline void CpuPause()
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Polls ready() with a pause instruction for strategy.spinTimeInNanoSeconds and then with a thread yield
+// for strategy.yieldTimeInNanoSeconds, both limited by timeoutInNanoSeconds.
+// Returns true as soon as ready() returns true, the time spent is subtracted from timeoutInNanoSeconds.
+template <typename F>
+bool SpinWait(const WaitStrategy &strategy, uint64_t &timeoutInNanoSeconds, F ready)
+{
+    if (ready())
+    {
+        return true;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto spinEnd = std::min(strategy.spinTimeInNanoSeconds, timeoutInNanoSeconds);
+    const auto yieldEnd = std::min(strategy.spinTimeInNanoSeconds + strategy.yieldTimeInNanoSeconds, timeoutInNanoSeconds);
+
+    auto elapsed = [&start]()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    };
+
+    auto updateTimeout = [&]()
+    {
+        if (timeoutInNanoSeconds != UINT64_MAX)
+        {
+            const auto e = elapsed();
+            timeoutInNanoSeconds = e < timeoutInNanoSeconds ? timeoutInNanoSeconds - e : 0;
+        }
+    };
+
+    while (elapsed() < spinEnd)
+    {
+        for (uint32_t i = 0; i < strategy.pauseCount; ++i)
+        {
+            CpuPause();
+        }
+        if (ready())
+        {
+            updateTimeout();
+            return true;
+        }
+    }
+
+    while (elapsed() < yieldEnd)
+    {
+        std::this_thread::yield();
+        if (ready())
+        {
+            updateTimeout();
+            return true;
+        }
+    }
+
+    updateTimeout();
+    return false;
+}
+
+} // namespace vkw
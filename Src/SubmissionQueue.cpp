@@ -0,0 +1,236 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include "Error.h"
+
+namespace vkw
+{
+
+SubmissionQueue::SubmissionQueue(const Queue &queue, uint32_t capacity)
+    : queue_(queue)
+    , mask_(capacity - 1)
+    , slots_(new Slot[capacity])
+{
+    assert(queue && capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+    for (uint32_t i = 0; i < capacity; ++i)
+    {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    submitInfos_.reserve(capacity);
+
+    thread_ = std::thread(&SubmissionQueue::Run, this);
+}
+
+SubmissionQueue::~SubmissionQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_.store(true);
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+SubmissionQueue::Token SubmissionQueue::Push(const Span<CommandBuffer> &commandBuffers, const Span2<Semaphore> &waitSemaphores,
+                                             const Span2<Semaphore> &signalSemaphores, const Fence &signalFence)
+{
+    auto pos = enqueuePos_.load(std::memory_order_relaxed);
+    Slot *slot = nullptr;
+    for (;;)
+    {
+        slot = &slots_[pos & mask_];
+        const auto sequence = slot->sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+        if (diff == 0)
+        {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // the ring is full, sleep until the submit thread has released the entry which used the slot before
+            WaitSubmitted(pos - mask_ - 1);
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    // the vectors keep their capacity, so a reused slot does not allocate
+    auto &entry = slot->entry;
+    entry.commandBuffers.resize(commandBuffers.Count());
+    commandBuffers.Emplace(entry.commandBuffers.data());
+    entry.waitSemaphores.resize(waitSemaphores.Count());
+    waitSemaphores.Emplace(entry.waitSemaphores.data());
+    entry.waitDstStageMask.resize(waitSemaphores.Count());
+    for (uint32_t i = 0; i < waitSemaphores.Count(); ++i)
+    {
+        entry.waitDstStageMask[i] = waitSemaphores[i].GetPipeLineStageFlag();
+    }
+    entry.signalSemaphores.resize(signalSemaphores.Count());
+    signalSemaphores.Emplace(entry.signalSemaphores.data());
+    entry.signalFence = VkFence(signalFence);
+
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_one();
+    }
+
+    return pos;
+}
+
+bool SubmissionQueue::IsSubmitted(Token token) const
+{
+    return submitted_.load(std::memory_order_acquire) > token;
+}
+
+void SubmissionQueue::Wait(Token token)
+{
+    WaitSubmitted(token);
+
+    if (failed_.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lock(completionMutex_);
+        while (!failures_.empty() && failures_.front().end <= token)
+        {
+            failures_.pop_front();
+        }
+        if (!failures_.empty() && failures_.front().begin <= token)
+        {
+            const auto result = failures_.front().result;
+            failures_.pop_front();
+            failed_.store(!failures_.empty(), std::memory_order_release);
+            throw Exception(result);
+        }
+        failed_.store(!failures_.empty(), std::memory_order_release);
+    }
+}
+
+void SubmissionQueue::WaitSubmitted(Token token)
+{
+    if (!IsSubmitted(token))
+    {
+        waiters_.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(completionMutex_);
+            completionCv_.wait(lock, [&] { return IsSubmitted(token); });
+        }
+        waiters_.fetch_sub(1);
+    }
+}
+
+void SubmissionQueue::Run()
+{
+    for (;;)
+    {
+        const auto count = GetReadyCount();
+        if (count > 0)
+        {
+            Process(count);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cv_.wait(lock, [&] { return stop_.load() || GetReadyCount() > 0; });
+        sleeping_.store(false, std::memory_order_relaxed);
+
+        if (stop_.load() && GetReadyCount() == 0)
+        {
+            return;
+        }
+    }
+}
+
+uint32_t SubmissionQueue::GetReadyCount() const
+{
+    uint32_t count = 0;
+    while (count <= mask_ && slots_[(dequeuePos_ + count) & mask_].sequence.load(std::memory_order_acquire) == dequeuePos_ + count + 1)
+    {
+        ++count;
+    }
+    return count;
+}
+
+void SubmissionQueue::Process(uint32_t count)
+{
+    uint32_t first = 0;
+    while (first < count)
+    {
+        submitInfos_.clear();
+        VkFence signalFence = VK_NULL_HANDLE;
+
+        auto last = first;
+        while (last < count)
+        {
+            const auto &entry = slots_[(dequeuePos_ + last) & mask_].entry;
+            submitInfos_.push_back({VK_STRUCTURE_TYPE_SUBMIT_INFO, nullptr,
+                                    static_cast<uint32_t>(entry.waitSemaphores.size()), entry.waitSemaphores.data(), entry.waitDstStageMask.data(),
+                                    static_cast<uint32_t>(entry.commandBuffers.size()), entry.commandBuffers.data(),
+                                    static_cast<uint32_t>(entry.signalSemaphores.size()), entry.signalSemaphores.data()});
+            ++last;
+            if (entry.signalFence != VK_NULL_HANDLE)
+            {
+                signalFence = entry.signalFence;
+                break;
+            }
+        }
+
+        const auto result = vkQueueSubmit(VkQueue(queue_), static_cast<uint32_t>(submitInfos_.size()), submitInfos_.data(), signalFence);
+        if (result < VK_SUCCESS)
+        {
+            std::lock_guard<std::mutex> lock(completionMutex_);
+            failures_.push_back({dequeuePos_ + first, dequeuePos_ + last, result});
+            failed_.store(true, std::memory_order_release);
+        }
+
+        for (auto i = first; i < last; ++i)
+        {
+            const auto pos = dequeuePos_ + i;
+            slots_[pos & mask_].sequence.store(pos + mask_ + 1, std::memory_order_release);
+        }
+        submitted_.store(dequeuePos_ + last);
+
+        first = last;
+    }
+    dequeuePos_ += count;
+
+    if (waiters_.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(completionMutex_);
+        completionCv_.notify_all();
+    }
+}
+
+} // namespace vkw
@@ -0,0 +1,54 @@
+/*
+Copyright(c) 2018 Marcus Rogowsky
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanWrapper.h"
+
+#include "Error.h"
+
+namespace vkw
+{
+
+SubmitBatch::SubmitBatch(uint32_t commandBufferCount, const Span2<Semaphore> &waitSemaphores, const Span2<Semaphore> &signalSemaphores)
+    : SubmitBatch(nullptr, commandBufferCount, waitSemaphores, signalSemaphores)
+{}
+
+SubmitBatch::SubmitBatch(const void *pNext, uint32_t commandBufferCount, const Span2<Semaphore> &waitSemaphores, const Span2<Semaphore> &signalSemaphores)
+    : waitSemaphores_(waitSemaphores.Count())
+    , waitDstStageMask_(waitSemaphores.Count())
+    , commandBuffers_(commandBufferCount, VK_NULL_HANDLE)
+    , signalSemaphores_(signalSemaphores.Count())
+{
+    waitSemaphores.Emplace(waitSemaphores_.data());
+    for (uint32_t i = 0; i < waitSemaphores.Count(); ++i)
+    {
+        waitDstStageMask_[i] = waitSemaphores[i].GetPipeLineStageFlag();
+    }
+    signalSemaphores.Emplace(signalSemaphores_.data());
+
+    submitInfo_ = {VK_STRUCTURE_TYPE_SUBMIT_INFO, pNext,
+                   static_cast<uint32_t>(waitSemaphores_.size()), waitSemaphores_.empty() ? nullptr : waitSemaphores_.data(),
+                   waitDstStageMask_.empty() ? nullptr : waitDstStageMask_.data(),
+                   static_cast<uint32_t>(commandBuffers_.size()), commandBuffers_.empty() ? nullptr : commandBuffers_.data(),
+                   static_cast<uint32_t>(signalSemaphores_.size()), signalSemaphores_.empty() ? nullptr : signalSemaphores_.data()};
+}
+
+} // namespace vkw